@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "agendador.hpp"
+
+// Inicialização do membro estático
+std::atomic<int> Tarefa::contadorTarefas{0};
+
+void Tarefa::logar(const std::string& msg) const {
+    // Várias threads logando: uma linha inteira por vez
+    static std::mutex mutexLog;
+    std::lock_guard<std::mutex> trava(mutexLog);
+    std::cout << "[LOG - Tarefa " << id << "]: " << msg << std::endl;
+}
+
+void LiberaTarefa::operator()(Tarefa* tarefa) const {
+    if (tarefa->origem != nullptr)
+        tarefa->origem->devolver(tarefa);
+    else
+        delete tarefa;
+}
+
+// --- Deque de Chase-Lev ---
+
+DequeDeTrabalho::Buffer::Buffer(int64_t capacidade)
+    : capacidade(capacidade), itens(new std::atomic<Tarefa*>[capacidade]) {
+}
+
+DequeDeTrabalho::DequeDeTrabalho() {
+    buffers.emplace_back(new Buffer(256));
+    buffer.store(buffers.back().get(), std::memory_order_relaxed);
+}
+
+void DequeDeTrabalho::empilhar(Tarefa* tarefa) {
+    int64_t b = base.load(std::memory_order_relaxed);
+    int64_t t = topo.load(std::memory_order_acquire);
+    Buffer* atual = buffer.load(std::memory_order_relaxed);
+
+    if (b - t > atual->capacidade - 1) {
+        // Cheio: dobra, copiando o que ainda não foi pego
+        buffers.emplace_back(new Buffer(atual->capacidade * 2));
+        Buffer* maior = buffers.back().get();
+        for (int64_t i = t; i < b; ++i)
+            (*maior)[i].store((*atual)[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        buffer.store(maior, std::memory_order_release);
+        atual = maior;
+    }
+
+    (*atual)[b].store(tarefa, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    base.store(b + 1, std::memory_order_relaxed);
+}
+
+Tarefa* DequeDeTrabalho::desempilhar() {
+    int64_t b = base.load(std::memory_order_relaxed) - 1;
+    Buffer* atual = buffer.load(std::memory_order_relaxed);
+    base.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = topo.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        base.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Tarefa* tarefa = (*atual)[b].load(std::memory_order_relaxed);
+    if (t == b) {
+        // Último item: disputa com os ladrões pelo topo
+        if (!topo.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            tarefa = nullptr;
+        base.store(b + 1, std::memory_order_relaxed);
+    }
+    return tarefa;
+}
+
+Tarefa* DequeDeTrabalho::roubar() {
+    int64_t t = topo.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = base.load(std::memory_order_acquire);
+    if (t >= b)
+        return nullptr;
+
+    Buffer* atual = buffer.load(std::memory_order_acquire);
+    Tarefa* tarefa = (*atual)[t].load(std::memory_order_relaxed);
+    if (!topo.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr; // outro ladrão (ou o dono) levou
+    return tarefa;
+}
+
+bool DequeDeTrabalho::vazia() const {
+    return base.load(std::memory_order_acquire) - topo.load(std::memory_order_acquire) <= 0;
+}
+
+// --- Filas de injeção ---
+
+void Agendador::FilaDeInjecao::colocar(Tarefa* const* tarefas, size_t quantidade) {
+    std::lock_guard<std::mutex> trava(mutex);
+    itens.insert(itens.end(), tarefas, tarefas + quantidade);
+    tamanho.store(itens.size(), std::memory_order_relaxed);
+}
+
+size_t Agendador::FilaDeInjecao::retirar(Tarefa** saida, size_t maximo) {
+    std::lock_guard<std::mutex> trava(mutex);
+    size_t quantidade = std::min(maximo, itens.size());
+    std::copy(itens.begin(), itens.begin() + quantidade, saida);
+    itens.erase(itens.begin(), itens.begin() + quantidade);
+    tamanho.store(itens.size(), std::memory_order_relaxed);
+    return quantidade;
+}
+
+// --- Agendador ---
+
+namespace {
+
+// Até quantas tarefas um trabalhador tira da fila de lote de uma vez
+const size_t LOTE_POR_VEZ = 32;
+// Tarefas finalizadas que um trabalhador acumula antes de atualizar `pendentes`
+const int64_t DESCARGA_A_CADA = 64;
+// Voltas procurando trabalho antes de dormir
+const int VOLTAS_ANTES_DE_DORMIR = 16;
+
+}
+
+// Contadores escritos só pelo próprio trabalhador (sem RMW atômico por
+// tarefa), lidos por progresso() de qualquer thread
+struct Agendador::Trabalhador {
+    DequeDeTrabalho deque;
+    alignas(64) std::atomic<uint64_t> concluidas{0};
+    std::atomic<uint64_t> canceladas{0};
+    std::atomic<double> somaProgresso{0.0};
+    int64_t finalizadasSemDescarregar = 0;
+    uint64_t semente;
+};
+
+thread_local Agendador* Agendador::agendadorAtual = nullptr;
+thread_local Agendador::Trabalhador* Agendador::trabalhadorAtual = nullptr;
+
+Agendador::Agendador(unsigned quantidade)
+    : inicio(std::chrono::steady_clock::now()) {
+    if (quantidade == 0)
+        quantidade = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 0; i < quantidade; ++i) {
+        trabalhadores.emplace_back(new Trabalhador());
+        trabalhadores.back()->semente = 0x9e3779b97f4a7c15ULL * (i + 1);
+    }
+    for (unsigned i = 0; i < quantidade; ++i)
+        threads.emplace_back(&Agendador::laco, this, i);
+}
+
+Agendador::~Agendador() {
+    processarTudo();
+    {
+        std::lock_guard<std::mutex> trava(mutexSono);
+        parar.store(true);
+    }
+    cvSono.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void Agendador::adicionarTarefa(TarefaPtr tarefa) {
+    Tarefa* bruta = tarefa.release();
+    enfileirar(&bruta, 1);
+}
+
+void Agendador::adicionarTarefa(std::unique_ptr<Tarefa> tarefa) {
+    adicionarTarefa(TarefaPtr(tarefa.release()));
+}
+
+void Agendador::adicionarTarefas(std::vector<TarefaPtr> tarefas) {
+    std::vector<Tarefa*> brutas;
+    brutas.reserve(tarefas.size());
+    for (auto& tarefa : tarefas)
+        brutas.push_back(tarefa.release());
+    enfileirar(brutas.data(), brutas.size());
+}
+
+void Agendador::enfileirar(Tarefa** tarefas, size_t quantidade) {
+    if (quantidade == 0)
+        return;
+
+    uint64_t geracaoAtual = geracao.load(std::memory_order_acquire);
+    for (size_t i = 0; i < quantidade; ++i)
+        tarefas[i]->geracao = geracaoAtual;
+    Tarefa** fimInterativas = std::stable_partition(tarefas, tarefas + quantidade, [](const Tarefa* tarefa) {
+        return tarefa->prioridade == Prioridade::Interativa;
+    });
+
+    // Conta antes de publicar: um trabalhador pode terminar a tarefa antes desta função voltar
+    submetidas.fetch_add(quantidade, std::memory_order_relaxed);
+    pendentes.fetch_add(static_cast<int64_t>(quantidade), std::memory_order_acq_rel);
+
+    if (fimInterativas != tarefas)
+        interativas.colocar(tarefas, fimInterativas - tarefas);
+    if (agendadorAtual == this) {
+        for (Tarefa** tarefa = fimInterativas; tarefa != tarefas + quantidade; ++tarefa)
+            trabalhadorAtual->deque.empilhar(*tarefa);
+    } else if (fimInterativas != tarefas + quantidade) {
+        lote.colocar(fimInterativas, tarefas + quantidade - fimInterativas);
+    }
+
+    acordar(quantidade > 1);
+}
+
+// Par do dormindo.fetch_add + haTrabalho() em laco(): ou o trabalhador vê
+// a tarefa nova, ou quem publicou vê que ele está dormindo
+void Agendador::acordar(bool todos) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (dormindo.load(std::memory_order_relaxed) == 0)
+        return;
+    std::lock_guard<std::mutex> trava(mutexSono);
+    if (todos)
+        cvSono.notify_all();
+    else
+        cvSono.notify_one();
+}
+
+bool Agendador::haTrabalho() const {
+    if (!interativas.vazia() || !lote.vazia())
+        return true;
+    for (const auto& trabalhador : trabalhadores)
+        if (!trabalhador->deque.vazia())
+            return true;
+    return false;
+}
+
+void Agendador::laco(unsigned indice) {
+    Trabalhador& eu = *trabalhadores[indice];
+    agendadorAtual = this;
+    trabalhadorAtual = &eu;
+
+    while (true) {
+        Tarefa* tarefa = nullptr;
+        for (int volta = 0; volta < VOLTAS_ANTES_DE_DORMIR && tarefa == nullptr; ++volta) {
+            tarefa = proxima(eu);
+            if (tarefa == nullptr) {
+                // Sem trabalho à vista: o que terminou precisa aparecer em `pendentes`
+                descarregarContagem(eu);
+                std::this_thread::yield();
+            }
+        }
+        if (tarefa != nullptr) {
+            rodar(eu, tarefa);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> trava(mutexSono);
+        dormindo.fetch_add(1, std::memory_order_seq_cst);
+        while (!parar.load() && !haTrabalho())
+            cvSono.wait(trava);
+        dormindo.fetch_sub(1, std::memory_order_relaxed);
+        if (parar.load() && !haTrabalho())
+            break;
+    }
+
+    agendadorAtual = nullptr;
+    trabalhadorAtual = nullptr;
+}
+
+Tarefa* Agendador::proxima(Trabalhador& eu) {
+    Tarefa* pegas[LOTE_POR_VEZ];
+
+    if (!interativas.vazia() && interativas.retirar(pegas, 1) == 1)
+        return pegas[0];
+
+    if (Tarefa* tarefa = eu.deque.desempilhar())
+        return tarefa;
+
+    if (!lote.vazia()) {
+        // Pega uma parte justa da fila, o resto fica para os outros
+        size_t parte = std::max<size_t>(1, lote.tamanhoAproximado() / trabalhadores.size());
+        size_t quantidade = lote.retirar(pegas, std::min(parte, LOTE_POR_VEZ));
+        if (quantidade > 0) {
+            // Empilhadas ao contrário para sair na ordem de chegada
+            for (size_t i = quantidade; i-- > 1;)
+                eu.deque.empilhar(pegas[i]);
+            if (quantidade > 1)
+                acordar(false);
+            return pegas[0];
+        }
+    }
+
+    return roubar(eu);
+}
+
+Tarefa* Agendador::roubar(Trabalhador& eu) {
+    size_t total = trabalhadores.size();
+    if (total < 2)
+        return nullptr;
+
+    // xorshift: cada ladrão começa por uma vítima diferente
+    eu.semente ^= eu.semente << 13;
+    eu.semente ^= eu.semente >> 7;
+    eu.semente ^= eu.semente << 17;
+    size_t primeira = eu.semente % total;
+
+    for (size_t n = 0; n < total; ++n) {
+        Trabalhador& vitima = *trabalhadores[(primeira + n) % total];
+        if (&vitima == &eu)
+            continue;
+        if (Tarefa* tarefa = vitima.deque.roubar())
+            return tarefa;
+    }
+    return nullptr;
+}
+
+void Agendador::rodar(Trabalhador& eu, Tarefa* tarefa) {
+    if (tarefa->foiCancelada() || tarefa->geracao <= geracaoCancelada.load(std::memory_order_acquire)) {
+        eu.canceladas.store(eu.canceladas.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    } else {
+        try {
+            tarefa->executar();
+        } catch (const std::exception& e) {
+            tarefa->logar(std::string("Falhou: ") + e.what());
+        }
+        eu.concluidas.store(eu.concluidas.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        eu.somaProgresso.store(eu.somaProgresso.load(std::memory_order_relaxed) + tarefa->calcularProgresso(),
+                               std::memory_order_relaxed);
+    }
+
+    LiberaTarefa()(tarefa);
+    if (++eu.finalizadasSemDescarregar == DESCARGA_A_CADA)
+        descarregarContagem(eu);
+}
+
+void Agendador::descarregarContagem(Trabalhador& eu) {
+    int64_t finalizadas = eu.finalizadasSemDescarregar;
+    if (finalizadas == 0)
+        return;
+    eu.finalizadasSemDescarregar = 0;
+
+    if (pendentes.fetch_sub(finalizadas, std::memory_order_acq_rel) == finalizadas) {
+        std::lock_guard<std::mutex> trava(mutexFim);
+        cvFim.notify_all();
+    }
+}
+
+void Agendador::processarTudo() {
+    std::unique_lock<std::mutex> trava(mutexFim);
+    cvFim.wait(trava, [this] { return pendentes.load(std::memory_order_acquire) == 0; });
+}
+
+void Agendador::cancelarTudo() {
+    // Tudo enfileirado até aqui tem geração <= a atual; as próximas recebem a seguinte
+    geracaoCancelada.store(geracao.fetch_add(1, std::memory_order_acq_rel), std::memory_order_release);
+}
+
+ProgressoAgendador Agendador::progresso() const {
+    ProgressoAgendador progresso;
+    double somaProgresso = 0.0;
+    for (const auto& trabalhador : trabalhadores) {
+        progresso.concluidas += trabalhador->concluidas.load(std::memory_order_relaxed);
+        progresso.canceladas += trabalhador->canceladas.load(std::memory_order_relaxed);
+        somaProgresso += trabalhador->somaProgresso.load(std::memory_order_relaxed);
+    }
+    progresso.submetidas = submetidas.load(std::memory_order_relaxed);
+
+    if (progresso.submetidas > 0)
+        progresso.progresso = static_cast<float>(somaProgresso / progresso.submetidas);
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    if (segundos > 0)
+        progresso.tarefasPorSegundo = progresso.concluidas / segundos;
+    return progresso;
+}
@@ -0,0 +1,343 @@
+#ifndef AGENDADOR_HPP
+#define AGENDADOR_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// --- INTERFACE (Classe Abstrata Pura) ---
+// Define um "contrato". Qualquer coisa que implemente isso DEVE ter o método logar().
+class ILogravel {
+public:
+    virtual void logar(const std::string& mensagem) const = 0; // Método puramente virtual
+    virtual ~ILogravel() = default; // Destrutor virtual é crucial em interfaces
+};
+
+// Interativas (consultas de alguém esperando) passam na frente das de lote (backfills)
+enum class Prioridade {
+    Interativa,
+    Lote,
+};
+
+class PoolBase;
+
+// --- CLASSE BASE (Abstrata) ---
+class Tarefa : public ILogravel {
+protected:
+    // 'protected' permite que as classes filhas acessem, mas o mundo externo não.
+    int id;
+    std::string descricao;
+    // Atômico: o Agendador lê o estado de outra thread
+    std::atomic<bool> concluida;
+
+    // Membro Estático: Compartilhado por TODAS as instâncias desta classe
+    static std::atomic<int> contadorTarefas;
+
+public:
+    explicit Tarefa(std::string desc, Prioridade prioridade = Prioridade::Lote)
+        : id(++contadorTarefas), descricao(std::move(desc)), concluida(false), prioridade(prioridade) {
+    }
+
+    // Destrutor Virtual: Garante que o destrutor da classe filha seja chamado
+    virtual ~Tarefa() = default;
+
+    // Método puramente virtual: Torna esta classe ABSTRATA (não pode ser instanciada)
+    virtual void executar() = 0;
+
+    // Método virtual comum: Pode ser sobrescrito, mas tem comportamento padrão
+    virtual float calcularProgresso() const {
+        return concluida ? 100.0f : 0.0f;
+    }
+
+    int getId() const { return id; }
+    Prioridade getPrioridade() const { return prioridade; }
+
+    // Uma tarefa cancelada antes de começar nunca roda; uma que já está
+    // rodando pode consultar foiCancelada() e parar mais cedo
+    void cancelar() { cancelada.store(true, std::memory_order_relaxed); }
+    bool foiCancelada() const { return cancelada.load(std::memory_order_relaxed); }
+
+    // Implementação da Interface ILogravel
+    void logar(const std::string& msg) const override;
+
+    static int getTotalTarefasCriadas() {
+        return contadorTarefas;
+    }
+
+    bool operator==(const Tarefa& outra) const {
+        return this->id == outra.id;
+    }
+
+private:
+    friend class Agendador;
+    friend class PoolBase;
+    friend struct LiberaTarefa;
+
+    Prioridade prioridade;
+    std::atomic<bool> cancelada{false};
+    uint64_t geracao = 0;      // geração do Agendador quando foi enfileirada
+    PoolBase* origem = nullptr; // pool que forneceu a memória, nullptr = new
+};
+
+// Devolve a tarefa ao pool de onde veio, ou faz delete
+struct LiberaTarefa {
+    void operator()(Tarefa* tarefa) const;
+};
+
+using TarefaPtr = std::unique_ptr<Tarefa, LiberaTarefa>;
+
+class PoolBase {
+public:
+    virtual ~PoolBase() = default;
+    virtual void devolver(Tarefa* tarefa) = 0;
+
+protected:
+    static void marcarOrigem(Tarefa* tarefa, PoolBase* pool) { tarefa->origem = pool; }
+};
+
+// Pool de objetos para um tipo de tarefa: a memória de cada tarefa é reusada
+// em vez de um new/delete por tarefa. Os slots livres ficam espalhados em
+// listas por shard, cada thread usa a sua, então criar e devolver de várias
+// threads não disputam o mesmo mutex. Deve viver mais que as suas tarefas.
+template<typename T>
+class PoolDeTarefas : public PoolBase {
+public:
+    explicit PoolDeTarefas(size_t slotsPorBloco = 256) : slotsPorBloco(std::max<size_t>(slotsPorBloco, 1)) {}
+
+    PoolDeTarefas(const PoolDeTarefas&) = delete;
+    PoolDeTarefas& operator=(const PoolDeTarefas&) = delete;
+
+    template<typename... Args>
+    TarefaPtr criar(Args&&... args) {
+        void* memoria = pegarSlot();
+        T* tarefa;
+        try {
+            tarefa = new (memoria) T(std::forward<Args>(args)...);
+        } catch (...) {
+            guardarSlot(memoria);
+            throw;
+        }
+        marcarOrigem(tarefa, this);
+        return TarefaPtr(tarefa);
+    }
+
+    void devolver(Tarefa* tarefa) override {
+        T* objeto = static_cast<T*>(tarefa);
+        objeto->~T();
+        guardarSlot(objeto);
+    }
+
+private:
+    static const size_t SHARDS = 64;
+
+    struct Slot {
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::vector<void*> livres;
+        std::atomic<size_t> quantos{0}; // livres.size(), lido sem a trava para pular shards vazios
+    };
+
+    static size_t meuShard() {
+        static std::atomic<size_t> proximo{0};
+        thread_local size_t shard = proximo.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+        return shard;
+    }
+
+    void* pegarSlot() {
+        size_t inicio = meuShard();
+        Shard& meu = shards[inicio];
+        {
+            std::lock_guard<std::mutex> trava(meu.mutex);
+            if (!meu.livres.empty()) {
+                void* slot = meu.livres.back();
+                meu.livres.pop_back();
+                meu.quantos.store(meu.livres.size(), std::memory_order_relaxed);
+                return slot;
+            }
+        }
+
+        // Quem cria costuma não ser quem devolve, então o shard de quem cria
+        // esvazia: leva metade dos livres de outro shard de uma vez, e as
+        // próximas criações voltam a achar slot no próprio shard
+        for (size_t n = 1; n < SHARDS; ++n) {
+            Shard& vitima = shards[(inicio + n) % SHARDS];
+            if (vitima.quantos.load(std::memory_order_relaxed) == 0)
+                continue;
+            std::scoped_lock travas(meu.mutex, vitima.mutex);
+            size_t levar = (vitima.livres.size() + 1) / 2;
+            if (levar == 0)
+                continue;
+            meu.livres.insert(meu.livres.end(), vitima.livres.end() - levar, vitima.livres.end());
+            vitima.livres.resize(vitima.livres.size() - levar);
+            vitima.quantos.store(vitima.livres.size(), std::memory_order_relaxed);
+            void* slot = meu.livres.back();
+            meu.livres.pop_back();
+            meu.quantos.store(meu.livres.size(), std::memory_order_relaxed);
+            return slot;
+        }
+
+        // Tudo ocupado: aloca um bloco novo, o resto dele vai para o shard desta thread
+        Slot* bloco;
+        {
+            std::lock_guard<std::mutex> trava(mutexBlocos);
+            blocos.emplace_back(new Slot[slotsPorBloco]);
+            bloco = blocos.back().get();
+        }
+        std::lock_guard<std::mutex> trava(meu.mutex);
+        for (size_t i = 1; i < slotsPorBloco; ++i)
+            meu.livres.push_back(&bloco[i]);
+        meu.quantos.store(meu.livres.size(), std::memory_order_relaxed);
+        return &bloco[0];
+    }
+
+    void guardarSlot(void* slot) {
+        Shard& shard = shards[meuShard()];
+        std::lock_guard<std::mutex> trava(shard.mutex);
+        shard.livres.push_back(slot);
+        shard.quantos.store(shard.livres.size(), std::memory_order_relaxed);
+    }
+
+    size_t slotsPorBloco;
+    Shard shards[SHARDS];
+    std::mutex mutexBlocos;
+    std::vector<std::unique_ptr<Slot[]>> blocos;
+};
+
+// Deque de Chase-Lev (Lê et al., "Correct and Efficient Work-Stealing for
+// Weak Memory Models"): o dono empilha e desempilha no fim sem travas, os
+// outros trabalhadores roubam do começo com um CAS.
+class DequeDeTrabalho {
+public:
+    DequeDeTrabalho();
+
+    DequeDeTrabalho(const DequeDeTrabalho&) = delete;
+    DequeDeTrabalho& operator=(const DequeDeTrabalho&) = delete;
+
+    // Só o dono
+    void empilhar(Tarefa* tarefa);
+    Tarefa* desempilhar();
+    // Qualquer thread
+    Tarefa* roubar();
+    bool vazia() const;
+
+private:
+    struct Buffer {
+        explicit Buffer(int64_t capacidade);
+        std::atomic<Tarefa*>& operator[](int64_t i) { return itens[i & (capacidade - 1)]; }
+
+        int64_t capacidade;
+        std::unique_ptr<std::atomic<Tarefa*>[]> itens;
+    };
+
+    alignas(64) std::atomic<int64_t> topo{0};
+    alignas(64) std::atomic<int64_t> base{0};
+    std::atomic<Buffer*> buffer;
+    // Buffers antigos ficam vivos até o fim: um ladrão pode estar lendo deles
+    std::vector<std::unique_ptr<Buffer>> buffers;
+};
+
+struct ProgressoAgendador {
+    uint64_t submetidas = 0;
+    uint64_t concluidas = 0;       // executar() retornou
+    uint64_t canceladas = 0;       // descartadas sem rodar
+    float progresso = 0.0f;        // 0..100, soma de calcularProgresso() sobre as submetidas
+    double tarefasPorSegundo = 0.0; // concluídas desde a criação do Agendador
+};
+
+// --- CLASSE GERENCIADORA ---
+// Executor com roubo de trabalho: cada trabalhador tem sua deque, tarefas
+// criadas por uma tarefa vão para a deque de quem criou, e trabalhador ocioso
+// rouba dos outros. Tarefas vindas de fora entram por duas filas de injeção
+// (interativa e lote); as interativas são olhadas antes de qualquer outra coisa.
+class Agendador {
+public:
+    // 0 = um trabalhador por núcleo
+    explicit Agendador(unsigned trabalhadores = 0);
+    // Espera o que já foi enfileirado terminar (chame cancelarTudo() antes para descartar)
+    ~Agendador();
+
+    Agendador(const Agendador&) = delete;
+    Agendador& operator=(const Agendador&) = delete;
+
+    // Thread-safe, de dentro ou de fora das tarefas
+    void adicionarTarefa(TarefaPtr tarefa);
+    void adicionarTarefa(std::unique_ptr<Tarefa> tarefa);
+    // Um lock por lote em vez de um por tarefa
+    void adicionarTarefas(std::vector<TarefaPtr> tarefas);
+
+    // Bloqueia até todas as tarefas enfileiradas terem rodado ou sido
+    // canceladas. Não pode ser chamado de dentro de uma tarefa.
+    void processarTudo();
+
+    // Descarta tudo que foi enfileirado até agora e ainda não começou
+    void cancelarTudo();
+
+    ProgressoAgendador progresso() const;
+    unsigned numeroDeTrabalhadores() const { return static_cast<unsigned>(trabalhadores.size()); }
+
+private:
+    struct Trabalhador;
+
+    class FilaDeInjecao {
+    public:
+        void colocar(Tarefa* const* tarefas, size_t quantidade);
+        // Até `maximo` tarefas de uma vez, na ordem de chegada
+        size_t retirar(Tarefa** saida, size_t maximo);
+        bool vazia() const { return tamanho.load(std::memory_order_relaxed) == 0; }
+        size_t tamanhoAproximado() const { return tamanho.load(std::memory_order_relaxed); }
+
+    private:
+        std::mutex mutex;
+        std::deque<Tarefa*> itens;
+        std::atomic<size_t> tamanho{0};
+    };
+
+    void laco(unsigned indice);
+    Tarefa* proxima(Trabalhador& eu);
+    Tarefa* roubar(Trabalhador& eu);
+    void rodar(Trabalhador& eu, Tarefa* tarefa);
+    void descarregarContagem(Trabalhador& eu);
+    bool haTrabalho() const;
+    void acordar(bool todos);
+    void enfileirar(Tarefa** tarefas, size_t quantidade);
+
+    // Quem está rodando nesta thread, para que tarefas criadas por tarefas
+    // vão direto para a deque do próprio trabalhador
+    static thread_local Agendador* agendadorAtual;
+    static thread_local Trabalhador* trabalhadorAtual;
+
+    std::vector<std::unique_ptr<Trabalhador>> trabalhadores;
+    std::vector<std::thread> threads;
+
+    FilaDeInjecao interativas;
+    FilaDeInjecao lote;
+
+    std::atomic<uint64_t> geracao{1};
+    std::atomic<uint64_t> geracaoCancelada{0}; // tarefas com geração <= esta não rodam
+    std::atomic<uint64_t> submetidas{0};
+    std::atomic<int64_t> pendentes{0};
+    std::atomic<bool> parar{false};
+    std::chrono::steady_clock::time_point inicio;
+
+    std::atomic<int> dormindo{0};
+    std::mutex mutexSono;
+    std::condition_variable cvSono;
+
+    std::mutex mutexFim;
+    std::condition_variable cvFim;
+};
+
+#endif // AGENDADOR_HPP
@@ -0,0 +1,500 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "archiveReader.hpp"
+
+namespace {
+
+// Enough for every signature looksLikeImage() knows
+const size_t SNIFF_BYTES = 16;
+// cv::imdecode gets the member as a Mat, whose width is an int
+const uint64_t MAX_MEMBER_SIZE = static_cast<uint64_t>(std::numeric_limits<int>::max());
+
+// Forward reader over a FILE* with a big buffer. Short skips are read through
+// the buffer, since an fseeko would throw it away.
+class ArchiveFile {
+public:
+    explicit ArchiveFile(const std::string& path) : path(path) {
+        file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+            throw std::runtime_error("Can't open " + path + ": " + std::strerror(errno));
+        std::setvbuf(file, nullptr, _IOFBF, BUFFER_SIZE);
+        posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    ~ArchiveFile() {
+        std::fclose(file);
+    }
+
+    ArchiveFile(const ArchiveFile&) = delete;
+    ArchiveFile& operator=(const ArchiveFile&) = delete;
+
+    // Fewer than `size` bytes only at the end of the file
+    size_t readSome(void* buffer, size_t size) {
+        size_t got = std::fread(buffer, 1, size, file);
+        if (got < size && std::ferror(file))
+            throw std::runtime_error("Can't read " + path + ": " + std::strerror(errno));
+        offset += got;
+        return got;
+    }
+
+    void read(void* buffer, size_t size) {
+        if (readSome(buffer, size) != size)
+            throw std::runtime_error("Unexpected end of " + path);
+    }
+
+    void skip(uint64_t size) {
+        seek(offset + size);
+    }
+
+    void seek(uint64_t target) {
+        if (target >= offset && target - offset <= BUFFER_SIZE) {
+            unsigned char scratch[4096];
+            while (offset < target)
+                read(scratch, static_cast<size_t>(std::min<uint64_t>(target - offset, sizeof(scratch))));
+            return;
+        }
+        if (fseeko(file, static_cast<off_t>(target), SEEK_SET) != 0)
+            throw std::runtime_error("Can't seek in " + path + ": " + std::strerror(errno));
+        offset = target;
+    }
+
+    uint64_t size() const {
+        struct stat info;
+        if (fstat(fileno(file), &info) != 0)
+            throw std::runtime_error("Can't stat " + path + ": " + std::strerror(errno));
+        return static_cast<uint64_t>(info.st_size);
+    }
+
+    const std::string& name() const { return path; }
+
+private:
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    std::string path;
+    FILE* file;
+    uint64_t offset = 0;
+};
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    if (text.size() < suffix.size())
+        return false;
+    return std::equal(suffix.begin(), suffix.end(), text.end() - suffix.size(),
+                      [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+}
+
+// Reads a member stored as is. Only its first bytes are read when they don't look like an image.
+bool readStoredMember(ArchiveFile& file, uint64_t size, std::vector<unsigned char>& data) {
+    size_t head = static_cast<size_t>(std::min<uint64_t>(size, SNIFF_BYTES));
+    data.resize(head);
+    file.read(data.data(), head);
+    if (!looksLikeImage(data.data(), head)) {
+        file.skip(size - head);
+        return false;
+    }
+    data.resize(static_cast<size_t>(size));
+    file.read(data.data() + head, data.size() - head);
+    return true;
+}
+
+// --- tar (ustar, GNU long names, pax) ---
+
+uint64_t tarNumber(const unsigned char* field, size_t length) {
+    // GNU base-256, for sizes that don't fit in 11 octal digits
+    if (field[0] & 0x80) {
+        uint64_t value = field[0] & 0x7F;
+        for (size_t i = 1; i < length; i++)
+            value = (value << 8) | field[i];
+        return value;
+    }
+    size_t i = 0;
+    while (i < length && field[i] == ' ')
+        i++;
+    uint64_t value = 0;
+    for (; i < length && field[i] >= '0' && field[i] <= '7'; i++)
+        value = value * 8 + (field[i] - '0');
+    return value;
+}
+
+std::string tarString(const unsigned char* field, size_t length) {
+    const char* text = reinterpret_cast<const char*>(field);
+    return std::string(text, strnlen(text, length));
+}
+
+// Checksum field counted as spaces
+bool tarChecksumOk(const unsigned char* header) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < 512; i++)
+        sum += (i >= 148 && i < 156) ? ' ' : header[i];
+    return sum == tarNumber(header + 148, 8);
+}
+
+std::string tarName(const unsigned char* header) {
+    std::string name = tarString(header, 100);
+    // ustar splits long paths between prefix and name
+    if (std::memcmp(header + 257, "ustar", 5) == 0 && header[345] != 0)
+        name = tarString(header + 345, 155) + "/" + name;
+    return name;
+}
+
+uint64_t tarPadding(uint64_t size) {
+    return (512 - size % 512) % 512;
+}
+
+// pax extended header: "<length> <key>=<value>\n" records, only path and size matter here
+void parsePax(const std::string& records, std::string& path, uint64_t& size, bool& hasSize) {
+    size_t position = 0;
+    while (position < records.size()) {
+        size_t space = records.find(' ', position);
+        if (space == std::string::npos)
+            break;
+        uint64_t length = std::strtoull(records.c_str() + position, nullptr, 10);
+        if (length == 0 || position + length > records.size())
+            break;
+        size_t end = position + length - 1; // o '\n' do registro
+        size_t equals = records.find('=', space);
+        if (equals < end) {
+            std::string key = records.substr(space + 1, equals - space - 1);
+            std::string value = records.substr(equals + 1, end - equals - 1);
+            if (key == "path") {
+                path = value;
+            } else if (key == "size") {
+                size = std::strtoull(value.c_str(), nullptr, 10);
+                hasSize = true;
+            }
+        }
+        position += length;
+    }
+}
+
+size_t readTar(ArchiveFile& file, const ArchiveSink& sink) {
+    size_t images = 0;
+    unsigned char header[512];
+    std::vector<unsigned char> data;
+    // Set by the 'L' / 'x' members that describe the next one
+    std::string longName;
+    std::string paxPath;
+    uint64_t paxSize = 0;
+    bool hasPaxSize = false;
+
+    while (true) {
+        size_t got = file.readSome(header, sizeof(header));
+        if (got == 0)
+            break; // sem os blocos zerados do fim: aceita como o GNU tar
+        if (got < sizeof(header))
+            throw std::runtime_error("Truncated tar header in " + file.name());
+        if (std::all_of(header, header + sizeof(header), [](unsigned char c) { return c == 0; }))
+            break;
+        if (!tarChecksumOk(header))
+            throw std::runtime_error("Bad tar header checksum in " + file.name());
+
+        uint64_t size = tarNumber(header + 124, 12);
+        char type = static_cast<char>(header[156]);
+
+        if (type == 'L' || type == 'x') {
+            std::string text(static_cast<size_t>(size), '\0');
+            file.read(&text[0], text.size());
+            file.skip(tarPadding(size));
+            if (type == 'L')
+                longName = text.c_str();
+            else
+                parsePax(text, paxPath, paxSize, hasPaxSize);
+            continue;
+        }
+        if (type == 'K' || type == 'g') {
+            // Long link target / global pax header: nothing we use
+            file.skip(size + tarPadding(size));
+            continue;
+        }
+
+        if (hasPaxSize)
+            size = paxSize;
+        std::string name = !paxPath.empty() ? paxPath : !longName.empty() ? longName : tarName(header);
+        longName.clear();
+        paxPath.clear();
+        hasPaxSize = false;
+
+        bool regular = type == '0' || type == '\0' || type == '7';
+        if (regular && size > MAX_MEMBER_SIZE) {
+            std::cerr << "WARNING: Skipping " << archiveMemberPath(file.name(), name) << ": too big" << std::endl;
+            file.skip(size);
+        } else if (regular && size > 0 && readStoredMember(file, size, data)) {
+            sink(name, data);
+            images++;
+        } else if (!regular) {
+            file.skip(size);
+        }
+        file.skip(tarPadding(size));
+    }
+    return images;
+}
+
+// --- zip (stored, deflate, zip64) ---
+
+uint16_t le16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t le32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t le64(const unsigned char* p) {
+    return static_cast<uint64_t>(le32(p)) | (static_cast<uint64_t>(le32(p + 4)) << 32);
+}
+
+struct ZipEntry {
+    std::string name;
+    uint64_t offset;         // local header
+    uint64_t compressedSize;
+    uint64_t size;
+    uint32_t crc;
+    uint16_t method;
+    uint16_t flags;
+};
+
+// The central directory has the real sizes even for members written with a
+// data descriptor, where the local header only has zeros
+std::vector<ZipEntry> readCentralDirectory(ArchiveFile& file) {
+    uint64_t fileSize = file.size();
+    size_t tailSize = static_cast<size_t>(std::min<uint64_t>(fileSize, 22 + 0xFFFF + 20));
+    std::vector<unsigned char> tail(tailSize);
+    file.seek(fileSize - tailSize);
+    file.read(tail.data(), tailSize);
+
+    // End of central directory record, searched backwards past the comment
+    long eocd = -1;
+    for (long i = static_cast<long>(tailSize) - 22; i >= 0; i--) {
+        if (le32(&tail[i]) == 0x06054b50) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0)
+        throw std::runtime_error("No zip end of central directory in " + file.name());
+
+    uint64_t entries = le16(&tail[eocd + 10]);
+    uint64_t directorySize = le32(&tail[eocd + 12]);
+    uint64_t directoryOffset = le32(&tail[eocd + 16]);
+
+    // Zip64: the locator right before points to a record with the 64-bit values
+    if (eocd >= 20 && le32(&tail[eocd - 20]) == 0x07064b50) {
+        unsigned char record[56];
+        file.seek(le64(&tail[eocd - 20 + 8]));
+        file.read(record, sizeof(record));
+        if (le32(record) != 0x06064b50)
+            throw std::runtime_error("Bad zip64 end of central directory in " + file.name());
+        entries = le64(record + 32);
+        directorySize = le64(record + 40);
+        directoryOffset = le64(record + 48);
+    }
+    if (directoryOffset + directorySize > fileSize)
+        throw std::runtime_error("Zip central directory past the end of " + file.name());
+
+    std::vector<unsigned char> directory(static_cast<size_t>(directorySize));
+    file.seek(directoryOffset);
+    file.read(directory.data(), directory.size());
+
+    std::vector<ZipEntry> result;
+    size_t position = 0;
+    for (uint64_t n = 0; n < entries; n++) {
+        if (position + 46 > directory.size() || le32(&directory[position]) != 0x02014b50)
+            throw std::runtime_error("Bad zip central directory in " + file.name());
+        const unsigned char* header = &directory[position];
+        size_t nameLength = le16(header + 28);
+        size_t extraLength = le16(header + 30);
+        size_t commentLength = le16(header + 32);
+        if (position + 46 + nameLength + extraLength + commentLength > directory.size())
+            throw std::runtime_error("Bad zip central directory in " + file.name());
+
+        ZipEntry entry;
+        entry.flags = le16(header + 8);
+        entry.method = le16(header + 10);
+        entry.crc = le32(header + 16);
+        entry.compressedSize = le32(header + 20);
+        entry.size = le32(header + 24);
+        entry.offset = le32(header + 42);
+        entry.name.assign(reinterpret_cast<const char*>(header + 46), nameLength);
+
+        // Zip64 extra field: 64-bit versions of the fields saturated at 0xFFFFFFFF, in this order
+        const unsigned char* extra = header + 46 + nameLength;
+        for (size_t x = 0; x + 4 <= extraLength;) {
+            size_t length = le16(extra + x + 2);
+            if (x + 4 + length > extraLength)
+                break;
+            if (le16(extra + x) == 0x0001) {
+                const unsigned char* field = extra + x + 4;
+                const unsigned char* end = field + length;
+                for (uint64_t* value : {&entry.size, &entry.compressedSize, &entry.offset}) {
+                    if (*value == 0xFFFFFFFF && field + 8 <= end) {
+                        *value = le64(field);
+                        field += 8;
+                    }
+                }
+            }
+            x += 4 + length;
+        }
+
+        result.push_back(entry);
+        position += 46 + nameLength + extraLength + commentLength;
+    }
+
+    // Na ordem do arquivo, para ler tudo numa passada só
+    std::stable_sort(result.begin(), result.end(), [](const ZipEntry& a, const ZipEntry& b) { return a.offset < b.offset; });
+    return result;
+}
+
+// Raw deflate stream, inflateEnd() even when a read throws halfway
+class InflateStream {
+public:
+    InflateStream() {
+        std::memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+            throw std::runtime_error("inflateInit2 failed");
+    }
+
+    ~InflateStream() {
+        inflateEnd(&stream);
+    }
+
+    InflateStream(const InflateStream&) = delete;
+    InflateStream& operator=(const InflateStream&) = delete;
+
+    z_stream stream;
+};
+
+// Inflates a deflated member into `data`. Stops after the first bytes when
+// they don't look like an image. False for those and for corrupt streams.
+bool inflateMember(ArchiveFile& file, const ZipEntry& entry, std::vector<unsigned char>& data) {
+    InflateStream inflater;
+    z_stream& stream = inflater.stream;
+
+    // Primeiro só o bastante para reconhecer o formato; o membro inteiro
+    // só é alocado quando parece uma imagem
+    data.resize(static_cast<size_t>(std::min<uint64_t>(entry.size, SNIFF_BYTES)));
+    unsigned char input[64 * 1024];
+    uint64_t remaining = entry.compressedSize;
+    stream.next_out = data.data();
+    stream.avail_out = static_cast<uInt>(data.size());
+    bool sniffed = false;
+    bool image = true;
+    int status = Z_OK;
+
+    while (status != Z_STREAM_END) {
+        if (stream.avail_in == 0) {
+            if (remaining == 0)
+                break;
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, sizeof(input)));
+            file.read(input, chunk);
+            remaining -= chunk;
+            stream.next_in = input;
+            stream.avail_in = static_cast<uInt>(chunk);
+        }
+        status = inflate(&stream, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+            break;
+
+        if (!sniffed && (stream.avail_out == 0 || status == Z_STREAM_END)) {
+            sniffed = true;
+            if (!looksLikeImage(data.data(), stream.total_out)) {
+                image = false;
+                break;
+            }
+            data.resize(static_cast<size_t>(entry.size));
+            stream.next_out = data.data() + stream.total_out;
+            stream.avail_out = static_cast<uInt>(entry.size - stream.total_out);
+        } else if (status == Z_BUF_ERROR && stream.avail_out == 0 && stream.avail_in > 0) {
+            break; // mais dados do que o diretório central diz
+        }
+    }
+
+    bool complete = status == Z_STREAM_END && stream.total_out == entry.size;
+    file.skip(remaining);
+    if (image && !complete)
+        std::cerr << "ERROR: Corrupt deflate stream in " << archiveMemberPath(file.name(), entry.name) << std::endl;
+    return image && complete;
+}
+
+size_t readZip(ArchiveFile& file, const ArchiveSink& sink) {
+    std::vector<ZipEntry> entries = readCentralDirectory(file);
+    size_t images = 0;
+    std::vector<unsigned char> data;
+
+    for (const ZipEntry& entry : entries) {
+        if (entry.name.empty() || entry.name.back() == '/' || entry.size == 0)
+            continue;
+        std::string label = archiveMemberPath(file.name(), entry.name);
+        if (entry.flags & 1) {
+            std::cerr << "WARNING: Skipping " << label << ": encrypted" << std::endl;
+            continue;
+        }
+        if (entry.method != 0 && entry.method != 8) {
+            std::cerr << "WARNING: Skipping " << label << ": compression method " << entry.method << std::endl;
+            continue;
+        }
+        if (entry.size > MAX_MEMBER_SIZE || (entry.method == 0 && entry.compressedSize != entry.size)) {
+            std::cerr << "WARNING: Skipping " << label << ": bad or too big size" << std::endl;
+            continue;
+        }
+
+        unsigned char local[30];
+        file.seek(entry.offset);
+        file.read(local, sizeof(local));
+        if (le32(local) != 0x04034b50)
+            throw std::runtime_error("Bad zip local header for " + label);
+        file.skip(le16(local + 26) + le16(local + 28));
+
+        bool image = entry.method == 0 ? readStoredMember(file, entry.size, data) : inflateMember(file, entry, data);
+        if (!image)
+            continue;
+        if (crc32(0L, data.data(), static_cast<uInt>(data.size())) != entry.crc) {
+            std::cerr << "ERROR: CRC mismatch in " << label << std::endl;
+            continue;
+        }
+        sink(entry.name, data);
+        images++;
+    }
+    return images;
+}
+
+}
+
+bool isArchivePath(const std::string& path) {
+    return endsWith(path, ".tar") || endsWith(path, ".zip");
+}
+
+bool looksLikeImage(const unsigned char* data, size_t size) {
+    auto startsWith = [&](const char* magic, size_t length) {
+        return size >= length && std::memcmp(data, magic, length) == 0;
+    };
+    return startsWith("\xFF\xD8\xFF", 3) ||               // JPEG
+           startsWith("\x89PNG\r\n\x1A\n", 8) ||          // PNG
+           startsWith("GIF87a", 6) || startsWith("GIF89a", 6) ||
+           startsWith("BM", 2) ||
+           (startsWith("RIFF", 4) && size >= 12 && std::memcmp(data + 8, "WEBP", 4) == 0) ||
+           startsWith("II*\0", 4) || startsWith("MM\0*", 4); // TIFF
+}
+
+std::string archiveMemberPath(const std::string& archive, const std::string& member) {
+    return archive + "!" + member;
+}
+
+size_t readArchive(const std::string& path, const ArchiveSink& sink) {
+    ArchiveFile file(path);
+    return endsWith(path, ".zip") ? readZip(file, sink) : readTar(file, sink);
+}
@@ -0,0 +1,35 @@
+#ifndef ARCHIVEREADER_HPP
+#define ARCHIVEREADER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Reads image members straight out of tar and zip archives, without
+// extracting them to disk. Tar is read as one forward pass over the file;
+// zip reads its central directory first (the sizes in the local headers may
+// be missing when the archive was written with data descriptors), then the
+// members in file order. Stored and deflated zip members are supported.
+
+// True for names ending in .tar or .zip, any case
+bool isArchivePath(const std::string& path);
+
+// JPEG, PNG, GIF, BMP, WebP or TIFF, judging by the first bytes only
+bool looksLikeImage(const unsigned char* data, size_t size);
+
+// How a member is reported in hash files: "archive!member"
+std::string archiveMemberPath(const std::string& archive, const std::string& member);
+
+// `data` holds the whole decompressed member; the sink may move it out
+using ArchiveSink = std::function<void(const std::string& member, std::vector<unsigned char>& data)>;
+
+// Calls `sink` for every regular member that looksLikeImage(), in archive
+// order. Other members are skipped without being read or inflated past
+// their first bytes. Corrupt members (bad CRC, truncated deflate stream)
+// are reported on stderr and skipped. Returns the number of members passed
+// to `sink`; throws std::runtime_error when the archive can't be opened or
+// its structure is broken.
+size_t readArchive(const std::string& path, const ArchiveSink& sink);
+
+#endif // ARCHIVEREADER_HPP
@@ -4,70 +4,12 @@
 #include <memory> // Para smart pointers
 #include <ctime>
 
-// --- 1. INTERFACE (Classe Abstrata Pura) ---
-// Define um "contrato". Qualquer coisa que implemente isso DEVE ter o método logar().
-class ILogravel {
-public:
-    virtual void logar(const std::string& mensagem) const = 0; // Método puramente virtual
-    virtual ~ILogravel() = default; // Destrutor virtual é crucial em interfaces
-};
-
-// --- 2. CLASSE BASE (Abstrata) ---
-class Tarefa : public ILogravel {
-protected: 
-    // 'protected' permite que as classes filhas acessem, mas o mundo externo não.
-    int id;
-    std::string descricao;
-    bool concluida;
-    
-    // Membro Estático: Compartilhado por TODAS as instâncias desta classe
-    static int contadorTarefas; 
-
-public:
-    // Construtor
-    explicit Tarefa(std::string desc) 
-        : id(++contadorTarefas), descricao(std::move(desc)), concluida(false) {
-    }
-
-    // Destrutor Virtual: Garante que o destrutor da classe filha seja chamado
-    virtual ~Tarefa() {
-        std::cout << "[Memoria] Destruindo Tarefa ID " << id << std::endl;
-    }
-
-    // --- MÉTODOS VIRTUAIS (Polimorfismo) ---
-    
-    // Método puramente virtual: Torna esta classe ABSTRATA (não pode ser instanciada)
-    virtual void executar() = 0; 
-
-    // Método virtual comum: Pode ser sobrescrito, mas tem comportamento padrão
-    virtual float calcularProgresso() const {
-        return concluida ? 100.0f : 0.0f;
-    }
-
-    // --- MÉTODOS CONCRETOS ---
-    int getId() const { return id; }
-    
-    // Implementação da Interface ILogravel
-    void logar(const std::string& msg) const override {
-        std::cout << "[LOG - Tarefa " << id << "]: " << msg << std::endl;
-    }
-
-    // Getter Estático
-    static int getTotalTarefasCriadas() {
-        return contadorTarefas;
-    }
+#include "agendador.hpp"
 
-    // --- SOBRECARGA DE OPERADOR ---
-    // Permite comparar duas tarefas usando '=='
-    bool operator==(const Tarefa& outra) const {
-        return this->id == outra.id;
-    }
-};
+// ILogravel, Tarefa e o Agendador (executor com roubo de trabalho) ficam em agendador.hpp
+// g++ -std=c++17 classes.cpp agendador.cpp -pthread -o classes && ./classes
 
-// Inicialização do membro estático
-int Tarefa::contadorTarefas = 0;
-
-// --- 3. CLASSE DERIVADA 1: Tarefa de Backup ---
+// --- 1. CLASSE DERIVADA 1: Tarefa de Backup ---
 class BackupBancoDados : public Tarefa {
 private:
     std::string stringConexao;
@@ -94,7 +36,7 @@ public:
     }
 };
 
-// --- 4. CLASSE DERIVADA 2: Tarefa de Envio de Email ---
+// --- 2. CLASSE DERIVADA 2: Tarefa de Envio de Email ---
 class EnvioEmail : public Tarefa {
 private:
     std::string destinatario;
@@ -112,34 +54,11 @@ public:
     // Não sobrescreve calcularProgresso, usa o padrão da classe base (0 ou 100)
 };
 
-// --- 5. CLASSE GERENCIADORA (Composição) ---
-class Agendador {
-private:
-    // Uso de unique_ptr para gerenciamento automático de memória (RAII)
-    // Polimorfismo: O vetor guarda ponteiros para 'Tarefa', mas os objetos são 'Backup' ou 'Email'
-    std::vector<std::unique_ptr<Tarefa>> filaDeTarefas;
-
-public:
-    void adicionarTarefa(std::unique_ptr<Tarefa> tarefa) {
-        // move é necessário pois unique_ptr não pode ser copiado, apenas transferido
-        filaDeTarefas.push_back(std::move(tarefa));
-    }
-
-    void processarTudo() {
-        std::cout << "\n--- Iniciando Processamento do Agendador ---\n";
-        
-        // Loop range-based moderno
-        for (const auto& tarefa : filaDeTarefas) {
-            tarefa->executar(); // Chamada Polimórfica (o C++ decide qual 'executar' chamar em tempo de execução)
-            std::cout << "Progresso: " << tarefa->calcularProgresso() << "%\n";
-            std::cout << "--------------------------------\n";
-        }
-    }
-};
-
-// --- 6. FUNÇÃO PRINCIPAL ---
+// --- 3. FUNÇÃO PRINCIPAL ---
 int main() {
-    Agendador scheduler;
+    // O pool vem antes do agendador: as tarefas dele precisam voltar para um pool vivo
+    PoolDeTarefas<EnvioEmail> poolDeEmails;
+    Agendador scheduler(2);
 
     std::cout << "Tarefas antes: " << Tarefa::getTotalTarefasCriadas() << std::endl;
 
@@ -148,17 +67,22 @@ int main() {
         std::make_unique<BackupBancoDados>("Backup Diario", "DB_PROD_01", 5000)
     );
 
-    scheduler.adicionarTarefa(
-        std::make_unique<EnvioEmail>("Newsletter Semanal", "cliente@exemplo.com")
-    );
+    // Sem make_unique por tarefa: a memória vem do pool e volta para ele no fim
+    std::vector<TarefaPtr> emails;
+    for (int i = 0; i < 3; i++)
+        emails.push_back(poolDeEmails.criar("Newsletter Semanal", "cliente" + std::to_string(i) + "@exemplo.com"));
+    scheduler.adicionarTarefas(std::move(emails));
 
     std::cout << "Tarefas depois: " << Tarefa::getTotalTarefasCriadas() << std::endl;
 
     scheduler.processarTudo();
 
-    // Nota: Não precisamos chamar 'delete'. 
-    // Quando 'scheduler' sair de escopo, o vector é destruído.
-    // O vector destrói os unique_ptr, que destroem as Tarefas (chamando o destrutor virtual).
-    
+    ProgressoAgendador progresso = scheduler.progresso();
+    std::cout << "Progresso: " << progresso.progresso << "% (" << progresso.concluidas << " de "
+              << progresso.submetidas << " tarefas, " << progresso.canceladas << " canceladas)\n";
+
+    // Nota: Não precisamos chamar 'delete'.
+    // O agendador libera cada tarefa (delete ou de volta ao pool) assim que ela roda.
+
     return 0;
-}
\ No newline at end of file
+}
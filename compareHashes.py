@@ -0,0 +1,211 @@
+"""
+Throughput and correctness comparison between the C++ hashes (sajin) and imagehashlib.py.
+
+Both sides hash the same local corpus in their own process, one image at a time, and report
+the read + decode + hash time of every image. For each hash type and size this prints
+images/sec, p50/p99 latency, peak RSS and the Hamming distance distribution between the
+C++ and the Python hashes.
+
+Usage:
+	python3 compareHashes.py --sajin _build/sajin --corpus data
+	python3 compareHashes.py --sajin _build/sajin --corpus data --types ahash,phash,phash-dct --sizes 8,16 \\
+		--check --tolerance 2 --max-disagreement 0.05 --min-speedup 2
+
+With --check the exit status is 1 when the share of images whose hashes differ by more than
+--tolerance bits exceeds --max-disagreement, or the C++ speedup falls below --min-speedup.
+"""
+
+from __future__ import division, print_function
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+IMAGE_EXTENSIONS = ('.jpg', '.jpeg', '.png', '.bmp', '.gif', '.webp', '.tif', '.tiff')
+
+# hash type name used by sajin --hash -> imagehashlib function
+# phash-dct is checked against the standard pHash, so its distance distribution
+# is the agreement rate of the JPEG coefficient shortcut
+PYTHON_HASHES = {
+	'ahash': 'average_hash',
+	'phash': 'phash',
+	'phash-dct': 'phash',
+}
+
+
+def list_corpus(corpus):
+	paths = []
+	for root, _, files in os.walk(corpus):
+		for name in files:
+			if name.lower().endswith(IMAGE_EXTENSIONS):
+				paths.append(os.path.join(root, name))
+	return sorted(paths)
+
+
+def python_worker(hash_type, hash_size, list_path):
+	"""
+	Same output as `sajin --timings`: one "<hash>\\t<path>\\t<microseconds>" line per image.
+	"""
+	sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+	import imagehashlib
+	from PIL import Image
+
+	hash_func = getattr(imagehashlib, PYTHON_HASHES[hash_type])
+	with open(list_path) as f:
+		paths = [line.rstrip('\n') for line in f if line.strip()]
+
+	failures = 0
+	for path in paths:
+		start = time.perf_counter()
+		try:
+			image_hash = hash_func(Image.open(path), hash_size=hash_size)
+		except Exception as e:
+			sys.stderr.write('ERROR: %s: %s\n' % (path, e))
+			failures += 1
+			continue
+		micros = int((time.perf_counter() - start) * 1e6)
+		sys.stdout.write('%s\t%s\t%d\n' % (image_hash, path, micros))
+	return 1 if failures else 0
+
+
+def run_measured(command):
+	"""
+	Runs a worker and returns ({path: (hash, micros)}, peak RSS in MB, wall seconds).
+	The child is reaped with wait4() so its own peak RSS is reported, not the harness'.
+	"""
+	start = time.perf_counter()
+	with tempfile.TemporaryFile() as errors:
+		proc = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=errors)
+		output = proc.stdout.read().decode()
+		proc.stdout.close()
+		_, status, usage = os.wait4(proc.pid, 0)
+		proc.returncode = os.waitstatus_to_exitcode(status)
+		errors.seek(0)
+		sys.stderr.write(errors.read().decode())
+	wall = time.perf_counter() - start
+
+	results = {}
+	for line in output.splitlines():
+		fields = line.split('\t')
+		if len(fields) == 3:
+			results[fields[1]] = (fields[0], int(fields[2]))
+	# ru_maxrss is in kilobytes on Linux
+	return results, usage.ru_maxrss / 1024.0, wall
+
+
+def percentile(sorted_values, fraction):
+	if not sorted_values:
+		return 0.0
+	return sorted_values[min(len(sorted_values) - 1, int(len(sorted_values) * fraction))]
+
+
+def summarize(name, results, peak_rss):
+	latencies = sorted(micros / 1000.0 for _, micros in results.values())
+	total_seconds = sum(latencies) / 1000.0
+	throughput = len(latencies) / total_seconds if total_seconds > 0 else 0.0
+	print('  %-7s: %8.1f img/s, p50 %7.2f ms, p99 %7.2f ms, peak RSS %7.1f MB' % (
+		name, throughput, percentile(latencies, 0.50), percentile(latencies, 0.99), peak_rss))
+	return throughput
+
+
+def hamming(a, b):
+	if len(a) != len(b):
+		return None
+	return bin(int(a, 16) ^ int(b, 16)).count('1')
+
+
+def compare(args, hash_type, hash_size, list_path, image_count):
+	"""
+	Returns the list of threshold violations for one hash type and size.
+	"""
+	cpp, cpp_rss, _ = run_measured([args.sajin, '--hash', hash_type, '--size', str(hash_size), '--timings', '--list', list_path])
+	py, py_rss, _ = run_measured([sys.executable, os.path.abspath(__file__), '--worker', hash_type, str(hash_size), list_path])
+
+	print('%s %dx%d: %d images (C++ hashed %d, Python hashed %d)' % (
+		hash_type, hash_size, hash_size, image_count, len(cpp), len(py)))
+	cpp_throughput = summarize('C++', cpp, cpp_rss)
+	py_throughput = summarize('Python', py, py_rss)
+	speedup = cpp_throughput / py_throughput if py_throughput > 0 else float('inf')
+	print('  speedup: %.2fx' % speedup)
+
+	distribution = {}
+	disagreements = 0
+	compared = 0
+	for path in sorted(set(cpp) & set(py)):
+		distance = hamming(cpp[path][0], py[path][0])
+		distribution[distance] = distribution.get(distance, 0) + 1
+		compared += 1
+		if distance is None or distance > args.tolerance:
+			disagreements += 1
+
+	# an image only one side could hash counts as a disagreement too
+	missing = len(set(cpp) ^ set(py))
+	disagreements += missing
+	total = compared + missing
+	disagreement = disagreements / total if total else 0.0
+
+	known = [d for d in distribution if d is not None]
+	print('  distance: ' + ', '.join('%d: %d' % (d, distribution[d]) for d in sorted(known)) +
+		(', size mismatch: %d' % distribution[None] if None in distribution else ''))
+	if compared:
+		mean = sum(d * n for d, n in distribution.items() if d is not None) / compared
+		print('  mean distance %.2f bits, disagreement (> %d bits) %.1f%%' % (mean, args.tolerance, 100 * disagreement))
+
+	violations = []
+	if disagreement > args.max_disagreement:
+		violations.append('%s %d: disagreement %.3f > %.3f' % (hash_type, hash_size, disagreement, args.max_disagreement))
+	if speedup < args.min_speedup:
+		violations.append('%s %d: speedup %.2f < %.2f' % (hash_type, hash_size, speedup, args.min_speedup))
+	return violations
+
+
+def main():
+	if len(sys.argv) == 5 and sys.argv[1] == '--worker':
+		return python_worker(sys.argv[2], int(sys.argv[3]), sys.argv[4])
+
+	parser = argparse.ArgumentParser(description='Compare sajin against imagehashlib.py')
+	parser.add_argument('--sajin', required=True, help='path to the sajin executable')
+	parser.add_argument('--corpus', required=True, help='directory with the images to hash')
+	parser.add_argument('--types', default='ahash', help='comma separated hash types')
+	parser.add_argument('--sizes', default='8,16', help='comma separated hash sizes')
+	parser.add_argument('--limit', type=int, default=0, help='only use the first N images')
+	parser.add_argument('--check', action='store_true', help='exit with 1 when a threshold is crossed')
+	parser.add_argument('--tolerance', type=int, default=0, help='bits two hashes may differ by and still agree')
+	parser.add_argument('--max-disagreement', type=float, default=0.0, help='allowed share of disagreeing images')
+	parser.add_argument('--min-speedup', type=float, default=1.0, help='minimum C++ / Python throughput ratio')
+	args = parser.parse_args()
+
+	paths = list_corpus(args.corpus)
+	if args.limit:
+		paths = paths[:args.limit]
+	if not paths:
+		print('No images found in %s' % args.corpus, file=sys.stderr)
+		return 1
+
+	with tempfile.NamedTemporaryFile('w', suffix='.txt', delete=False) as f:
+		f.write('\n'.join(paths) + '\n')
+		list_path = f.name
+
+	violations = []
+	try:
+		for hash_type in args.types.split(','):
+			if hash_type not in PYTHON_HASHES:
+				print('Unknown hash type %s' % hash_type, file=sys.stderr)
+				return 1
+			for size in args.sizes.split(','):
+				violations += compare(args, hash_type, int(size), list_path, len(paths))
+	finally:
+		os.unlink(list_path)
+
+	if args.check and violations:
+		for violation in violations:
+			print('FAIL: ' + violation, file=sys.stderr)
+		return 1
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "concurrentHashIndex.hpp"
+
+struct ConcurrentHashIndex::Version {
+    Version(HashIndex base, int words, size_t capacity)
+        : base(std::move(base)), capacity(capacity),
+          ids(new uint64_t[capacity]), hashWords(new uint64_t[capacity * words]) {
+    }
+
+    const HashIndex base;
+
+    // Delta: slots [0, count) are complete and never written again
+    const size_t capacity;
+    std::unique_ptr<uint64_t[]> ids;
+    std::unique_ptr<uint64_t[]> hashWords;
+    std::atomic<size_t> count{0};
+};
+
+// Pins the current version for the duration of one query
+class ConcurrentHashIndex::ReadGuard {
+public:
+    explicit ReadGuard(const ConcurrentHashIndex& index)
+        : index(index), slot(index.enterRead()), version(index.current.load(std::memory_order_seq_cst)) {
+    }
+
+    ~ReadGuard() {
+        index.leaveRead(slot);
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+    const ConcurrentHashIndex& index;
+    std::atomic<uint64_t>* slot;
+    const Version* version;
+};
+
+ConcurrentHashIndex::ConcurrentHashIndex(int bits, size_t minDeltaCapacity)
+    : ConcurrentHashIndex(HashIndex(bits), minDeltaCapacity) {
+}
+
+ConcurrentHashIndex::ConcurrentHashIndex(HashIndex base, size_t minDeltaCapacity)
+    : hashBits(base.bits()), words(base.wordsPerHash()), minDeltaCapacity(std::max<size_t>(minDeltaCapacity, 1)),
+      current(nullptr) {
+    if (words < 1)
+        throw std::invalid_argument("The hash size must be >= 1 bit");
+    current.store(makeVersion(std::move(base)));
+}
+
+ConcurrentHashIndex::~ConcurrentHashIndex() {
+    // Nobody may be reading any more
+    for (auto& entry : retired)
+        delete entry.second;
+    delete current.load();
+}
+
+// The delta grows with the base, so a merge (a full copy) happens every
+// base/8 adds at the earliest and its cost stays amortized O(1) per add
+ConcurrentHashIndex::Version* ConcurrentHashIndex::makeVersion(HashIndex base) const {
+    size_t capacity = std::max(minDeltaCapacity, base.size() / 8);
+    return new Version(std::move(base), words, capacity);
+}
+
+// Um leitor anuncia a época em que entrou antes de ler `current`. Uma versão
+// retirada na época r só é liberada quando todo slot ocupado tem época > r:
+// esses leitores entraram depois da troca e só podem ter visto a versão nova.
+// Quem entra no slot compartilhado herda uma época mais antiga que a sua, o
+// que só atrasa a liberação.
+std::atomic<uint64_t>* ConcurrentHashIndex::enterRead() const {
+    static std::atomic<size_t> nextHint{0};
+    thread_local size_t hint = nextHint.fetch_add(1, std::memory_order_relaxed);
+
+    while (true) {
+        for (size_t n = 0; n < READER_SLOTS; ++n) {
+            std::atomic<uint64_t>& slot = readers[(hint + n) % READER_SLOTS].epoch;
+            uint64_t idle = IDLE;
+            if (slot.load(std::memory_order_relaxed) == IDLE &&
+                slot.compare_exchange_strong(idle, globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst))
+                return &slot;
+        }
+
+        uint64_t shared = sharedReaders.epoch.load(std::memory_order_seq_cst);
+        while (shared == IDLE || (shared & SHARED_COUNT_MASK) < SHARED_COUNT_MASK) {
+            uint64_t joined = shared == IDLE ? (globalEpoch.load(std::memory_order_seq_cst) << SHARED_COUNT_BITS) | 1 : shared + 1;
+            if (sharedReaders.epoch.compare_exchange_weak(shared, joined, std::memory_order_seq_cst))
+                return nullptr;
+        }
+        // 65535 readers in the shared slot as well
+        std::this_thread::yield();
+    }
+}
+
+void ConcurrentHashIndex::leaveRead(std::atomic<uint64_t>* slot) const {
+    if (slot != nullptr) {
+        slot->store(IDLE, std::memory_order_release);
+        return;
+    }
+
+    uint64_t shared = sharedReaders.epoch.load(std::memory_order_relaxed);
+    while (!sharedReaders.epoch.compare_exchange_weak(shared, (shared & SHARED_COUNT_MASK) == 1 ? IDLE : shared - 1,
+                                                     std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+void ConcurrentHashIndex::publish(Version* fresh) {
+    Version* old = current.exchange(fresh, std::memory_order_seq_cst);
+    uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+    retired.emplace_back(epoch, old);
+    reclaim();
+}
+
+void ConcurrentHashIndex::reclaim() {
+    uint64_t oldest = IDLE;
+    for (const auto& reader : readers)
+        oldest = std::min(oldest, reader.epoch.load(std::memory_order_seq_cst));
+    uint64_t shared = sharedReaders.epoch.load(std::memory_order_seq_cst);
+    if (shared != IDLE)
+        oldest = std::min(oldest, shared >> SHARED_COUNT_BITS);
+
+    auto stillPinned = std::partition(retired.begin(), retired.end(),
+                                      [oldest](const std::pair<uint64_t, Version*>& entry) { return entry.first >= oldest; });
+    for (auto it = stillPinned; it != retired.end(); ++it)
+        delete it->second;
+    retired.erase(stillPinned, retired.end());
+}
+
+void ConcurrentHashIndex::mergeLocked() {
+    const Version* version = current.load(std::memory_order_relaxed);
+    size_t count = version->count.load(std::memory_order_relaxed);
+
+    HashIndex merged(hashBits);
+    merged.reserve(version->base.size() + count);
+    for (size_t i = 0; i < version->base.size(); ++i)
+        merged.add(version->base.idAt(i), version->base.hashAt(i));
+    for (size_t i = 0; i < count; ++i)
+        merged.add(version->ids[i], version->hashWords.get() + i * words);
+
+    publish(makeVersion(std::move(merged)));
+    mergeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ConcurrentHashIndex::add(uint64_t id, const uint64_t* hash) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+
+    // Only writers change `current`, and they hold the mutex
+    Version* version = current.load(std::memory_order_relaxed);
+    size_t slot = version->count.load(std::memory_order_relaxed);
+    if (slot == version->capacity) {
+        mergeLocked();
+        version = current.load(std::memory_order_relaxed);
+        slot = 0;
+    } else if (!retired.empty()) {
+        reclaim();
+    }
+
+    version->ids[slot] = id;
+    std::copy(hash, hash + words, version->hashWords.get() + slot * words);
+    version->count.store(slot + 1, std::memory_order_release);
+}
+
+void ConcurrentHashIndex::merge() {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (current.load(std::memory_order_relaxed)->count.load(std::memory_order_relaxed) > 0)
+        mergeLocked();
+}
+
+void ConcurrentHashIndex::reset(HashIndex base) {
+    if (base.bits() != hashBits)
+        throw std::invalid_argument("Index has " + std::to_string(base.bits()) + " bit hashes, expected " + std::to_string(hashBits));
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    publish(makeVersion(std::move(base)));
+}
+
+size_t ConcurrentHashIndex::size() const {
+    ReadGuard guard(*this);
+    return guard.version->base.size() + guard.version->count.load(std::memory_order_acquire);
+}
+
+std::vector<HashMatch> ConcurrentHashIndex::radiusQuery(const uint64_t* query, int radius) const {
+    ReadGuard guard(*this);
+    const Version* version = guard.version;
+
+    std::vector<HashMatch> matches = version->base.radiusQuery(query, radius);
+    size_t count = version->count.load(std::memory_order_acquire);
+    const uint64_t* data = version->hashWords.get();
+    for (size_t i = 0; i < count; ++i) {
+        int distance = hammingDistance(query, data + i * words, words);
+        if (distance <= radius)
+            matches.push_back({version->ids[i], distance});
+    }
+
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+std::vector<HashMatch> ConcurrentHashIndex::knnQuery(const uint64_t* query, size_t k) const {
+    if (k == 0)
+        return {};
+
+    ReadGuard guard(*this);
+    const Version* version = guard.version;
+
+    // Os k melhores da base entram no heap, o delta disputa com eles
+    std::vector<HashMatch> baseBest = version->base.knnQuery(query, k);
+    std::priority_queue<HashMatch> best(baseBest.begin(), baseBest.end());
+    size_t count = version->count.load(std::memory_order_acquire);
+    const uint64_t* data = version->hashWords.get();
+    for (size_t i = 0; i < count; ++i) {
+        HashMatch match{version->ids[i], hammingDistance(query, data + i * words, words)};
+        if (best.size() < k) {
+            best.push(match);
+        } else if (match < best.top()) {
+            best.pop();
+            best.push(match);
+        }
+    }
+
+    std::vector<HashMatch> matches(best.size());
+    for (size_t i = matches.size(); i-- > 0; best.pop())
+        matches[i] = best.top();
+    return matches;
+}
@@ -0,0 +1,91 @@
+#ifndef CONCURRENTHASHINDEX_HPP
+#define CONCURRENTHASHINDEX_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "hashIndex.hpp"
+
+// HashIndex that keeps answering queries while hashes are added.
+//
+// A version is an immutable base HashIndex plus an append-only delta
+// segment. add() writes the next delta slot and then publishes it by bumping
+// the delta count, so readers see every completed add without any lock.
+// When the delta fills up it is merged with the base into a new version,
+// published with one atomic pointer swap; the old one is freed once every
+// reader that could still hold it has left (epoch based reclamation).
+//
+// Readers never block: each one takes a slot of its own to announce its
+// epoch, and past READER_SLOTS concurrent readers the rest share one
+// ref-counted slot holding the oldest epoch among them. A steady stream of
+// such overflow readers keeps that epoch old and delays freeing retired
+// versions, so size READER_SLOTS for the expected query threads.
+//
+// Writers serialize on a mutex among themselves only, and the occasional
+// merge costs the writer that triggers it a copy of the base; the delta
+// grows with the base so that stays amortized O(1) per add.
+class ConcurrentHashIndex {
+public:
+    explicit ConcurrentHashIndex(int bits, size_t minDeltaCapacity = 65536);
+    explicit ConcurrentHashIndex(HashIndex base, size_t minDeltaCapacity = 65536);
+    ~ConcurrentHashIndex();
+
+    ConcurrentHashIndex(const ConcurrentHashIndex&) = delete;
+    ConcurrentHashIndex& operator=(const ConcurrentHashIndex&) = delete;
+
+    void add(uint64_t id, const uint64_t* hash);
+    // Folds the delta into a new base right away
+    void merge();
+    // Replaces the whole content, e.g. after reloading the index file
+    void reset(HashIndex base);
+
+    int bits() const { return hashBits; }
+    int wordsPerHash() const { return words; }
+    size_t size() const;
+    size_t merges() const { return mergeCount.load(std::memory_order_relaxed); }
+
+    // Same results as HashIndex, over every add() completed before the call
+    std::vector<HashMatch> radiusQuery(const uint64_t* query, int radius) const;
+    std::vector<HashMatch> knnQuery(const uint64_t* query, size_t k) const;
+
+private:
+    struct Version;
+    class ReadGuard;
+
+    static const size_t READER_SLOTS = 128;
+    static const uint64_t IDLE = UINT64_MAX;
+    // Shared slot layout: epoch << SHARED_COUNT_BITS | readers in it
+    static const int SHARED_COUNT_BITS = 16;
+    static const uint64_t SHARED_COUNT_MASK = (uint64_t(1) << SHARED_COUNT_BITS) - 1;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch{IDLE};
+    };
+
+    // nullptr: the reader went into the shared slot
+    std::atomic<uint64_t>* enterRead() const;
+    void leaveRead(std::atomic<uint64_t>* slot) const;
+    Version* makeVersion(HashIndex base) const;
+    void mergeLocked();
+    void publish(Version* fresh);
+    void reclaim();
+
+    int hashBits;
+    int words;
+    size_t minDeltaCapacity;
+
+    std::atomic<Version*> current;
+    std::atomic<uint64_t> globalEpoch{1};
+    mutable std::array<ReaderSlot, READER_SLOTS> readers;
+    mutable ReaderSlot sharedReaders;
+    std::atomic<size_t> mergeCount{0};
+
+    std::mutex writeMutex;
+    std::vector<std::pair<uint64_t, Version*>> retired; // (epoch when unpublished, version)
+};
+
+#endif // CONCURRENTHASHINDEX_HPP
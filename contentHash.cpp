@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cstring>
+
+#include "contentHash.hpp"
+
+namespace {
+
+const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian hosts only; memcpy compiles to a plain (unaligned) mov
+inline uint64_t read64(const unsigned char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t roundStep(uint64_t accumulator, uint64_t input) {
+    accumulator += input * PRIME2;
+    accumulator = rotl(accumulator, 31);
+    return accumulator * PRIME1;
+}
+
+inline uint64_t mergeRound(uint64_t hash, uint64_t accumulator) {
+    hash ^= roundStep(0, accumulator);
+    return hash * PRIME1 + PRIME4;
+}
+
+// 32-byte stripes into the four accumulators, returns the bytes consumed
+size_t consumeStripes(uint64_t* accumulators, const unsigned char* data, size_t size) {
+    const unsigned char* p = data;
+    const unsigned char* limit = data + size - size % 32;
+    uint64_t v1 = accumulators[0], v2 = accumulators[1], v3 = accumulators[2], v4 = accumulators[3];
+    for (; p < limit; p += 32) {
+        v1 = roundStep(v1, read64(p));
+        v2 = roundStep(v2, read64(p + 8));
+        v3 = roundStep(v3, read64(p + 16));
+        v4 = roundStep(v4, read64(p + 24));
+    }
+    accumulators[0] = v1;
+    accumulators[1] = v2;
+    accumulators[2] = v3;
+    accumulators[3] = v4;
+    return static_cast<size_t>(p - data);
+}
+
+}
+
+ContentHasher::ContentHasher(uint64_t seed) : seed(seed) {
+    accumulators[0] = seed + PRIME1 + PRIME2;
+    accumulators[1] = seed + PRIME2;
+    accumulators[2] = seed;
+    accumulators[3] = seed - PRIME1;
+}
+
+void ContentHasher::update(const void* data, size_t size) {
+    if (size == 0)
+        return;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    totalLength += size;
+
+    // Completa o stripe que sobrou da chamada anterior
+    if (buffered > 0) {
+        size_t take = std::min(size, sizeof(buffer) - buffered);
+        std::memcpy(buffer + buffered, p, take);
+        buffered += take;
+        p += take;
+        size -= take;
+        if (buffered < sizeof(buffer))
+            return;
+        consumeStripes(accumulators, buffer, sizeof(buffer));
+        buffered = 0;
+    }
+
+    size_t consumed = consumeStripes(accumulators, p, size);
+    std::memcpy(buffer, p + consumed, size - consumed);
+    buffered = size - consumed;
+}
+
+uint64_t ContentHasher::digest() const {
+    uint64_t hash;
+    if (totalLength >= 32) {
+        hash = rotl(accumulators[0], 1) + rotl(accumulators[1], 7) + rotl(accumulators[2], 12) + rotl(accumulators[3], 18);
+        for (uint64_t accumulator : accumulators)
+            hash = mergeRound(hash, accumulator);
+    } else {
+        hash = seed + PRIME5;
+    }
+    hash += totalLength;
+
+    const unsigned char* p = buffer;
+    const unsigned char* end = buffer + buffered;
+    for (; p + 8 <= end; p += 8) {
+        hash ^= roundStep(0, read64(p));
+        hash = rotl(hash, 27) * PRIME1 + PRIME4;
+    }
+    if (p + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read32(p)) * PRIME1;
+        hash = rotl(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        hash ^= *p * PRIME5;
+        hash = rotl(hash, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t contentHash(const void* data, size_t size, uint64_t seed) {
+    ContentHasher hasher(seed);
+    hasher.update(data, size);
+    return hasher.digest();
+}
@@ -0,0 +1,28 @@
+#ifndef CONTENTHASH_HPP
+#define CONTENTHASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// XXH64 (same output as xxhash's XXH64 / xxh64sum), used to recognise
+// byte-identical files. Not cryptographic: fine for a cache key, not for
+// anything an attacker controls both sides of.
+class ContentHasher {
+public:
+    explicit ContentHasher(uint64_t seed = 0);
+
+    // Can be fed in pieces of any size as the bytes arrive
+    void update(const void* data, size_t size);
+    uint64_t digest() const;
+
+private:
+    uint64_t accumulators[4];
+    uint64_t seed;
+    uint64_t totalLength = 0;
+    unsigned char buffer[32];
+    size_t buffered = 0;
+};
+
+uint64_t contentHash(const void* data, size_t size, uint64_t seed = 0);
+
+#endif // CONTENTHASH_HPP
@@ -0,0 +1,174 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dedupTable.hpp"
+#include "contentHash.hpp"
+#include "imageHash.hpp"
+#include "mappedFile.h"
+
+using Clock = std::chrono::steady_clock;
+
+static long long microsBetween(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+// The read() counterpart of map_file, with the same checks and messages
+static bool readWholeFile(const std::string& path, std::vector<unsigned char>& data) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Can't open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        std::cerr << "Can't read " << path << ": not a regular non-empty file" << std::endl;
+        close(fd);
+        return false;
+    }
+
+    data.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t got = read(fd, data.data() + done, data.size() - done);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0) {
+            // Encurtado enquanto era lido: como o SIGBUS do mapeamento
+            std::cerr << "Can't read " << path << ": " << (got < 0 ? std::strerror(errno) : "truncated while it was being read") << std::endl;
+            close(fd);
+            return false;
+        }
+        done += static_cast<size_t>(got);
+    }
+    close(fd);
+    return true;
+}
+
+DedupTable::DedupTable(const std::string& hashType, int hashSize, bool exifThumbnail, bool mapped)
+    : hashType(hashType), hashSize(hashSize), exifThumbnail(exifThumbnail), mapped(mapped) {
+    tag = hashType + "/" + std::to_string(hashSize) + (exifThumbnail ? "/exif" : "");
+}
+
+void DedupTable::openStore(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::ifstream in(path);
+    std::string line;
+    size_t loaded = 0;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string content, entryTag, hash;
+        uint64_t size;
+        long long micros;
+        // Uma linha cortada no fim (processo morto no meio da escrita) só é ignorada
+        if (!(fields >> content >> size >> entryTag >> micros >> hash) || entryTag != tag || content.size() != 16)
+            continue;
+        char* end;
+        Key key{std::strtoull(content.c_str(), &end, 16), size};
+        if (*end != '\0')
+            continue;
+        if (entries.emplace(key, Entry{hash, micros}).second)
+            loaded++;
+    }
+    // A linha cortada não pode grudar na primeira que vamos acrescentar
+    in.clear();
+    char last = '\n';
+    if (in.seekg(-1, std::ios::end))
+        in.get(last);
+    in.close();
+
+    store.open(path, std::ios::app);
+    if (!store)
+        throw std::runtime_error("Can't open dedup store " + path);
+    if (last != '\n')
+        store << '\n';
+    std::cerr << "Dedup store " << path << ": " << loaded << " " << tag << " entries" << std::endl;
+}
+
+std::string DedupTable::hashData(const unsigned char* data, size_t size, const std::string& name) {
+    Clock::time_point start = Clock::now();
+    Key key{contentHash(data, size), size};
+    Clock::time_point hashed = Clock::now();
+    contentMicros += microsBetween(start, hashed);
+    lookups++;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            hits++;
+            savedMicros += it->second.micros;
+            return it->second.hash;
+        }
+    }
+
+    // Fora da trava: duas cópias chegando juntas decodificam as duas, o que só custa tempo
+    std::string hash = hashImageData(data, size, name, hashType, hashSize, exifThumbnail);
+    if (hash.empty())
+        return hash;
+    long long micros = microsBetween(hashed, Clock::now());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.emplace(key, Entry{hash, micros}).second && store.is_open()) {
+        char content[17];
+        std::snprintf(content, sizeof(content), "%016llx", static_cast<unsigned long long>(key.content));
+        // Por linha: um --watch morto com Ctrl-C não perde o que já calculou
+        store << content << '\t' << size << '\t' << tag << '\t' << micros << '\t' << hash << std::endl;
+    }
+    return hash;
+}
+
+std::string DedupTable::hashFile(const std::string& path) {
+    if (!mapped) {
+        std::vector<unsigned char> data;
+        if (!readWholeFile(path, data))
+            return "";
+        return hashData(data.data(), data.size(), path);
+    }
+
+    MappedFile file;
+    if (map_file(path.c_str(), &file) != 0)
+        return "";
+
+    std::string hash;
+    try {
+        hash = hashData(file.data, file.size, path);
+    } catch (...) {
+        unmap_file(&file);
+        throw;
+    }
+    // What went into the table matches the zeroed bytes it saw, just not this file
+    if (file.truncated) {
+        std::cerr << "ERROR: " << path << " was truncated while it was being read" << std::endl;
+        hash.clear();
+    }
+    unmap_file(&file);
+    return hash;
+}
+
+size_t DedupTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+DedupStats DedupTable::stats() const {
+    DedupStats result;
+    result.lookups = lookups;
+    result.hits = hits;
+    result.savedMicros = savedMicros;
+    result.contentMicros = contentMicros;
+    return result;
+}
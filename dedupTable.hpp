@@ -0,0 +1,77 @@
+#ifndef DEDUPTABLE_HPP
+#define DEDUPTABLE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct DedupStats {
+    size_t lookups = 0;
+    size_t hits = 0;
+    long long savedMicros = 0;   // decode + hash time the hits took when they were first seen
+    long long contentMicros = 0; // spent computing content hashes, hits and misses
+};
+
+// Exact-duplicate prefilter in front of decoding. Inputs are keyed by the
+// XXH64 of their bytes plus their size; one seen before gets the perceptual
+// hash computed the first time instead of being decoded again. Files are
+// read once, through a mapping when `mapped` (like --mmap) or into a buffer
+// otherwise: the content hash runs over those bytes and a miss decodes the
+// same ones. Failed decodes are not remembered. Thread-safe.
+class DedupTable {
+public:
+    DedupTable(const std::string& hashType, int hashSize, bool exifThumbnail, bool mapped);
+
+    DedupTable(const DedupTable&) = delete;
+    DedupTable& operator=(const DedupTable&) = delete;
+
+    // Loads what earlier runs left in `path` and appends new entries to it,
+    // one "<xxh64 hex>\t<bytes>\t<hash type/size>\t<micros>\t<hash>" line
+    // each. Lines of other hash types or sizes are ignored and kept.
+    // Throws std::runtime_error when the file can't be opened for appending.
+    void openStore(const std::string& path);
+
+    // Same results as hashImageFile() / hashImageData(), "" on failure
+    std::string hashFile(const std::string& path);
+    std::string hashData(const unsigned char* data, size_t size, const std::string& name);
+
+    size_t size() const;
+    DedupStats stats() const;
+
+private:
+    struct Key {
+        uint64_t content;
+        uint64_t size;
+        bool operator==(const Key& other) const { return content == other.content && size == other.size; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return static_cast<size_t>(key.content ^ (key.size * 0x9E3779B97F4A7C15ULL)); }
+    };
+
+    struct Entry {
+        std::string hash;
+        long long micros;
+    };
+
+    std::string hashType;
+    int hashSize;
+    bool exifThumbnail;
+    bool mapped;
+    std::string tag; // "phash/8", "ahash/16/exif": what the stored hashes are
+
+    mutable std::mutex mutex;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    std::ofstream store;
+
+    std::atomic<size_t> lookups{0};
+    std::atomic<size_t> hits{0};
+    std::atomic<long long> savedMicros{0};
+    std::atomic<long long> contentMicros{0};
+};
+
+#endif // DEDUPTABLE_HPP
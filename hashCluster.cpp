@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "hashCluster.hpp"
+
+ConcurrentUnionFind::ConcurrentUnionFind(size_t n)
+    : n(n), parent(new std::atomic<uint32_t>[n]) {
+    for (size_t i = 0; i < n; ++i)
+        parent[i].store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+}
+
+uint32_t ConcurrentUnionFind::find(uint32_t x) {
+    while (true) {
+        uint32_t p = parent[x].load(std::memory_order_acquire);
+        if (p == x)
+            return x;
+
+        // Path halving: aponta x para o avô. Se outra thread ganhar o CAS, tudo bem,
+        // o avô continua sendo um ancestral válido.
+        uint32_t gp = parent[p].load(std::memory_order_acquire);
+        if (p != gp)
+            parent[x].compare_exchange_weak(p, gp, std::memory_order_release, std::memory_order_relaxed);
+        x = gp;
+    }
+}
+
+bool ConcurrentUnionFind::unite(uint32_t a, uint32_t b) {
+    while (true) {
+        a = find(a);
+        b = find(b);
+        if (a == b)
+            return false;
+
+        // Sempre liga a raiz maior na menor: a ordem total impede ciclos
+        if (a < b)
+            std::swap(a, b);
+        uint32_t expected = a;
+        if (parent[a].compare_exchange_strong(expected, b, std::memory_order_acq_rel))
+            return true;
+    }
+}
+
+bool ConcurrentUnionFind::same(uint32_t a, uint32_t b) {
+    while (true) {
+        a = find(a);
+        b = find(b);
+        if (a == b)
+            return true;
+        // a still a root means the two sets were really disjoint at this point
+        if (parent[a].load(std::memory_order_acquire) == a)
+            return false;
+    }
+}
+
+namespace {
+
+struct BandEntry {
+    uint64_t key;
+    uint32_t id;
+};
+
+// Thread-local counters, summed at the end
+struct JoinCounters {
+    size_t candidatePairs = 0;
+    size_t matchedPairs = 0;
+    size_t unions = 0;
+};
+
+// Square tiles keep both operand rows of the verification loop in L1
+const size_t verifyTile = 256;
+
+template <typename Body>
+void parallelFor(int threads, Body body) {
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t)
+        workers.emplace_back(body, t);
+    body(0);
+    for (auto& worker : workers)
+        worker.join();
+}
+
+// Sorts one chunk per thread, then merges neighbouring chunks pairwise
+template <typename It, typename Compare>
+void parallelSort(It first, It last, Compare comp, int threads) {
+    size_t n = last - first;
+    if (threads <= 1 || n < (1u << 16)) {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    std::vector<size_t> bounds(threads + 1);
+    for (int t = 0; t <= threads; ++t)
+        bounds[t] = n * t / threads;
+
+    parallelFor(threads, [&](int t) {
+        std::sort(first + bounds[t], first + bounds[t + 1], comp);
+    });
+
+    for (int width = 1; width < threads; width *= 2) {
+        std::vector<std::thread> merges;
+        for (int i = 0; i + width < threads; i += 2 * width) {
+            size_t lo = bounds[i], mid = bounds[i + width], hi = bounds[std::min(i + 2 * width, threads)];
+            merges.emplace_back([=] { std::inplace_merge(first + lo, first + mid, first + hi, comp); });
+        }
+        for (auto& merge : merges)
+            merge.join();
+    }
+}
+
+// Exact duplicates are united up front so the banding pass only sees one
+// representative per distinct hash (blank frames, re-uploads, ...)
+std::vector<uint32_t> collapseDuplicates(const PackedHashes& hashes, ConcurrentUnionFind& sets, int threads) {
+    int words = hashes.wordsPerHash;
+    std::vector<uint32_t> order(hashes.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = static_cast<uint32_t>(i);
+
+    parallelSort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const uint64_t* ha = hashes.at(a);
+        const uint64_t* hb = hashes.at(b);
+        for (int w = 0; w < words; ++w)
+            if (ha[w] != hb[w])
+                return ha[w] < hb[w];
+        return a < b;
+    }, threads);
+
+    std::vector<uint32_t> representatives;
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i > 0 && hammingDistance(hashes.at(order[i]), hashes.at(order[i - 1]), words) == 0) {
+            sets.unite(order[i], order[i - 1]);
+            continue;
+        }
+        representatives.push_back(order[i]);
+    }
+    return representatives;
+}
+
+// Rows of a bucket handed to one worker. Big buckets are cut into several
+// blocks so a single skewed band value doesn't leave one thread with all the work.
+struct VerifyBlock {
+    size_t first;    // bucket start in the sorted entries
+    size_t m;        // bucket size
+    size_t rowBegin;
+    size_t rowEnd;
+    size_t pairs;    // row i pairs with every j > i
+};
+
+const size_t blockRows = 4 * verifyTile;
+
+// Rows [rowBegin, rowEnd) of one bucket against every later row, tiled over a
+// gathered copy of the hashes they touch
+void verifyBlock(const PackedHashes& hashes, const BandEntry* bucket, const VerifyBlock& block, int threshold,
+                 ConcurrentUnionFind& sets, std::vector<uint64_t>& local, JoinCounters& counters) {
+    int words = hashes.wordsPerHash;
+    size_t m = block.m, base = block.rowBegin;
+    local.resize((m - base) * words);
+    for (size_t i = base; i < m; ++i)
+        std::copy(hashes.at(bucket[i].id), hashes.at(bucket[i].id) + words, local.data() + (i - base) * words);
+
+    for (size_t ib = base; ib < block.rowEnd; ib += verifyTile) {
+        size_t iEnd = std::min(ib + verifyTile, block.rowEnd);
+        for (size_t jb = ib; jb < m; jb += verifyTile) {
+            size_t jEnd = std::min(jb + verifyTile, m);
+            for (size_t i = ib; i < iEnd; ++i) {
+                const uint64_t* hi = local.data() + (i - base) * words;
+                for (size_t j = std::max(jb, i + 1); j < jEnd; ++j) {
+                    ++counters.candidatePairs;
+                    if (hammingDistance(hi, local.data() + (j - base) * words, words) > threshold)
+                        continue;
+                    ++counters.matchedPairs;
+                    if (sets.unite(bucket[i].id, bucket[j].id))
+                        ++counters.unions;
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+ClusterResult clusterHashes(const PackedHashes& hashes, const ClusterOptions& options) {
+    if (options.threshold < 0)
+        throw std::invalid_argument("The threshold must be >= 0");
+    if (hashes.size() > UINT32_MAX)
+        throw std::invalid_argument("Too many hashes for 32-bit ids");
+
+    auto start = std::chrono::steady_clock::now();
+    int threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    int bands = options.bands > 0 ? options.bands : options.threshold + 1;
+
+    ClusterResult result;
+    ClusterStats& stats = result.stats;
+    stats.hashes = hashes.size();
+
+    ConcurrentUnionFind sets(hashes.size());
+    std::vector<uint32_t> representatives = collapseDuplicates(hashes, sets, threads);
+    stats.uniqueHashes = representatives.size();
+
+    // No band split can keep the pigeonhole guarantee past one bit per band,
+    // but then no pair can be farther apart than the threshold either: the
+    // full pairwise join links everything, so skip straight to its result
+    if (options.threshold >= hashes.bits) {
+        bands = 0;
+        for (size_t i = 1; i < representatives.size(); ++i) {
+            ++stats.candidatePairs;
+            ++stats.matchedPairs;
+            if (sets.unite(representatives[0], representatives[i]))
+                ++stats.unions;
+        }
+        stats.largestBucket = representatives.size();
+    }
+    // More bands than bits only leaves empty bands; threshold + 1 still fits
+    bands = std::min(bands, hashes.bits);
+
+    // Pigeonhole: with threshold + 1 bands, two hashes within the threshold
+    // agree on at least one whole band, so sharing a band key is a complete
+    // candidate filter. Bands wider than 64 bits are keyed on their prefix.
+    std::vector<BandEntry> entries(representatives.size());
+    std::vector<JoinCounters> counters(threads);
+
+    for (int band = 0; band < bands; ++band) {
+        int bandStart = hashes.bits * band / bands;
+        int bandLength = std::min(hashes.bits * (band + 1) / bands - bandStart, 64);
+
+        parallelFor(threads, [&](int t) {
+            size_t lo = entries.size() * t / threads, hi = entries.size() * (t + 1) / threads;
+            for (size_t i = lo; i < hi; ++i)
+                entries[i] = {extractBits(hashes.at(representatives[i]), bandStart, bandLength), representatives[i]};
+        });
+        parallelSort(entries.begin(), entries.end(), [](const BandEntry& a, const BandEntry& b) {
+            return a.key < b.key;
+        }, threads);
+
+        // Buckets with 2+ members cut into row blocks, most pairs first so the tail of the work is small
+        std::vector<VerifyBlock> blocks;
+        for (size_t i = 0; i < entries.size();) {
+            size_t j = i + 1;
+            while (j < entries.size() && entries[j].key == entries[i].key)
+                ++j;
+            size_t m = j - i;
+            for (size_t row = 0; m > 1 && row + 1 < m; row += blockRows) {
+                size_t rowEnd = std::min(row + blockRows, m - 1);
+                // Soma de (m - 1 - r) para r em [row, rowEnd)
+                size_t pairs = (rowEnd - row) * (2 * m - row - rowEnd - 1) / 2;
+                blocks.push_back({i, m, row, rowEnd, pairs});
+            }
+            stats.largestBucket = std::max(stats.largestBucket, m);
+            i = j;
+        }
+        std::sort(blocks.begin(), blocks.end(), [](const VerifyBlock& a, const VerifyBlock& b) {
+            return a.pairs > b.pairs;
+        });
+
+        std::atomic<size_t> next{0};
+        parallelFor(threads, [&](int t) {
+            std::vector<uint64_t> local;
+            for (size_t b = next.fetch_add(1); b < blocks.size(); b = next.fetch_add(1))
+                verifyBlock(hashes, entries.data() + blocks[b].first, blocks[b], options.threshold, sets, local, counters[t]);
+        });
+    }
+
+    for (const auto& c : counters) {
+        stats.candidatePairs += c.candidatePairs;
+        stats.matchedPairs += c.matchedPairs;
+        stats.unions += c.unions;
+    }
+
+    // Raízes são sempre o menor índice do conjunto, então o rótulo é estável
+    result.labels.resize(hashes.size());
+    parallelFor(threads, [&](int t) {
+        size_t lo = hashes.size() * t / threads, hi = hashes.size() * (t + 1) / threads;
+        for (size_t i = lo; i < hi; ++i)
+            result.labels[i] = sets.find(static_cast<uint32_t>(i));
+    });
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::vector<std::vector<uint32_t>> groupClusters(const std::vector<uint32_t>& labels, size_t minSize) {
+    std::vector<uint32_t> counts(labels.size(), 0);
+    for (uint32_t label : labels)
+        ++counts[label];
+
+    std::vector<std::vector<uint32_t>> clusters;
+    std::vector<int64_t> slot(labels.size(), -1);
+    for (size_t i = 0; i < labels.size(); ++i) {
+        uint32_t label = labels[i];
+        if (counts[label] < minSize)
+            continue;
+        if (slot[label] < 0) {
+            slot[label] = static_cast<int64_t>(clusters.size());
+            clusters.emplace_back();
+            clusters.back().reserve(counts[label]);
+        }
+        clusters[slot[label]].push_back(static_cast<uint32_t>(i));
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const auto& a, const auto& b) {
+        return a.size() > b.size();
+    });
+    return clusters;
+}
@@ -0,0 +1,55 @@
+#ifndef HASHCLUSTER_HPP
+#define HASHCLUSTER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "hashOps.hpp"
+
+// Lock-free disjoint set: roots are always linked to the smaller index, so
+// concurrent unions can never form a cycle. find() does path halving.
+class ConcurrentUnionFind {
+public:
+    explicit ConcurrentUnionFind(size_t n);
+
+    uint32_t find(uint32_t x);
+    bool unite(uint32_t a, uint32_t b); // true when two sets were merged
+    bool same(uint32_t a, uint32_t b);
+    size_t size() const { return n; }
+
+private:
+    size_t n;
+    std::unique_ptr<std::atomic<uint32_t>[]> parent;
+};
+
+struct ClusterOptions {
+    int threshold = 4;  // maximum Hamming distance inside a cluster edge
+    int bands = 0;      // 0 = threshold + 1, the pigeonhole minimum for exact recall
+    int threads = 0;    // 0 = std::thread::hardware_concurrency()
+};
+
+struct ClusterStats {
+    size_t hashes = 0;
+    size_t uniqueHashes = 0;
+    size_t candidatePairs = 0;  // pairs sharing a band, each one is verified
+    size_t matchedPairs = 0;    // candidates within the threshold
+    size_t unions = 0;
+    size_t largestBucket = 0;
+    double seconds = 0.0;
+};
+
+struct ClusterResult {
+    std::vector<uint32_t> labels; // labels[i] = smallest index in the cluster of hash i
+    ClusterStats stats;
+};
+
+// All-pairs near-duplicate join: connected components of the graph where two
+// hashes are linked when their distance is <= options.threshold.
+ClusterResult clusterHashes(const PackedHashes& hashes, const ClusterOptions& options = {});
+
+// Clusters with at least minSize members, largest first
+std::vector<std::vector<uint32_t>> groupClusters(const std::vector<uint32_t>& labels, size_t minSize = 2);
+
+#endif // HASHCLUSTER_HPP
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hashIndex.hpp"
+
+static const char indexFileMagic[8] = {'S', 'J', 'I', 'N', 'D', 'X', '0', '1'};
+
+bool operator<(const HashMatch& a, const HashMatch& b) {
+    return a.distance != b.distance ? a.distance < b.distance : a.id < b.id;
+}
+
+HashIndex::HashIndex(int bits)
+    : hashes(makePackedHashes(bits)) {
+}
+
+void HashIndex::add(uint64_t id, const uint64_t* hash) {
+    ids.push_back(id);
+    hashes.push(hash);
+}
+
+void HashIndex::reserve(size_t count) {
+    ids.reserve(count);
+    hashes.words.reserve(count * hashes.wordsPerHash);
+}
+
+std::vector<HashMatch> HashIndex::radiusQuery(const uint64_t* query, int radius) const {
+    std::vector<HashMatch> matches;
+    int words = hashes.wordsPerHash;
+    const uint64_t* data = hashes.words.data();
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+        int distance = hammingDistance(query, data + i * words, words);
+        if (distance <= radius)
+            matches.push_back({ids[i], distance});
+    }
+
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+std::vector<HashMatch> HashIndex::knnQuery(const uint64_t* query, size_t k) const {
+    if (k == 0)
+        return {};
+
+    // Max-heap dos k melhores: o topo é o pior candidato aceito até agora
+    std::priority_queue<HashMatch> best;
+    int words = hashes.wordsPerHash;
+    const uint64_t* data = hashes.words.data();
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+        HashMatch match{ids[i], hammingDistance(query, data + i * words, words)};
+        if (best.size() < k) {
+            best.push(match);
+        } else if (match < best.top()) {
+            best.pop();
+            best.push(match);
+        }
+    }
+
+    std::vector<HashMatch> matches(best.size());
+    for (size_t i = matches.size(); i-- > 0; best.pop())
+        matches[i] = best.top();
+    return matches;
+}
+
+void HashIndex::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Can't open " + path);
+
+    uint32_t header[2] = {static_cast<uint32_t>(hashes.bits), 0};
+    uint64_t count = ids.size();
+    file.write(indexFileMagic, sizeof(indexFileMagic));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(hashes.words.data()), hashes.words.size() * sizeof(uint64_t));
+    if (!file)
+        throw std::runtime_error("Failed writing " + path);
+}
+
+HashIndex HashIndex::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Can't open " + path);
+
+    char magic[sizeof(indexFileMagic)] = {};
+    uint32_t header[2] = {};
+    uint64_t count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!file || std::memcmp(magic, indexFileMagic, sizeof(magic)) != 0)
+        throw std::runtime_error("Not an index file: " + path);
+
+    HashIndex index(static_cast<int>(header[0]));
+    index.ids.resize(count);
+    index.hashes.words.resize(count * index.hashes.wordsPerHash);
+    file.read(reinterpret_cast<char*>(index.ids.data()), index.ids.size() * sizeof(uint64_t));
+    file.read(reinterpret_cast<char*>(index.hashes.words.data()), index.hashes.words.size() * sizeof(uint64_t));
+    if (!file)
+        throw std::runtime_error("Truncated index file: " + path);
+
+    return index;
+}
@@ -0,0 +1,45 @@
+#ifndef HASHINDEX_HPP
+#define HASHINDEX_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "hashOps.hpp"
+
+struct HashMatch {
+    uint64_t id;
+    int distance;
+};
+
+// Flat near-duplicate index: hashes stay packed back to back so a query is
+// one sequential popcount scan. Results are ordered by (distance, id).
+class HashIndex {
+public:
+    HashIndex() = default;
+    explicit HashIndex(int bits);
+
+    void add(uint64_t id, const uint64_t* hash);
+    void reserve(size_t count);
+
+    size_t size() const { return ids.size(); }
+    int bits() const { return hashes.bits; }
+    int wordsPerHash() const { return hashes.wordsPerHash; }
+    uint64_t idAt(size_t i) const { return ids[i]; }
+    const uint64_t* hashAt(size_t i) const { return hashes.at(i); }
+
+    std::vector<HashMatch> radiusQuery(const uint64_t* query, int radius) const;
+    std::vector<HashMatch> knnQuery(const uint64_t* query, size_t k) const;
+
+    // "SJINDX01", uint32 bits, uint32 reserved, uint64 count, ids, packed words
+    void save(const std::string& path) const;
+    static HashIndex load(const std::string& path);
+
+private:
+    PackedHashes hashes;
+    std::vector<uint64_t> ids;
+};
+
+bool operator<(const HashMatch& a, const HashMatch& b);
+
+#endif // HASHINDEX_HPP
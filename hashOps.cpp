@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hashOps.hpp"
+
+static const char hashFileMagic[8] = {'S', 'J', 'H', 'A', 'S', 'H', '0', '1'};
+
+int wordsForBits(int bits) {
+    return (bits + 63) / 64;
+}
+
+PackedHashes makePackedHashes(int bits) {
+    if (bits < 1)
+        throw std::invalid_argument("The hash must have at least one bit");
+
+    PackedHashes hashes;
+    hashes.bits = bits;
+    hashes.wordsPerHash = wordsForBits(bits);
+    return hashes;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool hexToWords(const std::string& hex, uint64_t* out, int wordsPerHash) {
+    if (hex.size() > static_cast<size_t>(wordsPerHash) * 16)
+        return false;
+
+    std::fill(out, out + wordsPerHash, 0);
+    // Cada dígito hex ocupa 4 bits, alinhados à esquerda dentro da palavra
+    for (size_t k = 0; k < hex.size(); ++k) {
+        int nibble = hexValue(hex[k]);
+        if (nibble < 0)
+            return false;
+        out[k / 16] |= static_cast<uint64_t>(nibble) << ((15 - k % 16) * 4);
+    }
+    return true;
+}
+
+std::string wordsToHex(const uint64_t* hash, int bits) {
+    static const char* hexLookup = "0123456789abcdef";
+    size_t digits = (bits + 3) / 4;
+
+    std::string hex;
+    hex.reserve(digits);
+    for (size_t k = 0; k < digits; ++k)
+        hex += hexLookup[(hash[k / 16] >> ((15 - k % 16) * 4)) & 0x0F];
+    return hex;
+}
+
+uint64_t extractBits(const uint64_t* hash, int start, int length) {
+    if (length <= 0)
+        return 0;
+
+    int word = start / 64, offset = start % 64;
+    // Junta a palavra atual com a próxima quando o intervalo cruza a fronteira
+    uint64_t value = hash[word] << offset;
+    if (offset + length > 64)
+        value |= hash[word + 1] >> (64 - offset);
+    return length == 64 ? value : value >> (64 - length);
+}
+
+static PackedHashes readBinaryHashFile(std::ifstream& file, const std::string& path) {
+    uint32_t header[2];
+    uint64_t count = 0;
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!file)
+        throw std::runtime_error("Truncated hash file header: " + path);
+
+    PackedHashes hashes = makePackedHashes(static_cast<int>(header[0]));
+    hashes.words.resize(count * hashes.wordsPerHash);
+    file.read(reinterpret_cast<char*>(hashes.words.data()), hashes.words.size() * sizeof(uint64_t));
+    if (!file)
+        throw std::runtime_error("Truncated hash file: " + path);
+
+    return hashes;
+}
+
+static PackedHashes readTextHashFile(std::ifstream& file, const std::string& path) {
+    PackedHashes hashes;
+    std::vector<uint64_t> hash;
+    std::string line;
+    size_t lineNumber = 0;
+
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream fields(line);
+        std::string hex;
+        if (!(fields >> hex))
+            continue;
+
+        // O primeiro hash define o tamanho de todos os outros
+        if (hashes.bits == 0) {
+            hashes = makePackedHashes(static_cast<int>(hex.size() * 4));
+            hash.resize(hashes.wordsPerHash);
+        }
+
+        if (static_cast<int>(hex.size() * 4) != hashes.bits || !hexToWords(hex, hash.data(), hashes.wordsPerHash))
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": invalid hash '" + hex + "'");
+        hashes.push(hash.data());
+    }
+
+    return hashes;
+}
+
+PackedHashes readHashFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Can't open " + path);
+
+    char magic[sizeof(hashFileMagic)] = {};
+    file.read(magic, sizeof(magic));
+    if (file && std::memcmp(magic, hashFileMagic, sizeof(magic)) == 0)
+        return readBinaryHashFile(file, path);
+
+    file.clear();
+    file.seekg(0);
+    return readTextHashFile(file, path);
+}
+
+void writeHashFile(const std::string& path, const PackedHashes& hashes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Can't open " + path);
+
+    uint32_t header[2] = {static_cast<uint32_t>(hashes.bits), 0};
+    uint64_t count = hashes.size();
+    file.write(hashFileMagic, sizeof(hashFileMagic));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(hashes.words.data()), hashes.words.size() * sizeof(uint64_t));
+    if (!file)
+        throw std::runtime_error("Failed writing " + path);
+}
@@ -0,0 +1,46 @@
+#ifndef HASHOPS_HPP
+#define HASHOPS_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Hashes packed into 64-bit words and stored back to back: hash i lives in
+// words [i * wordsPerHash, (i + 1) * wordsPerHash). Bit 0 is the most
+// significant bit of word 0, i.e. the first bit of the hex string.
+struct PackedHashes {
+    int bits = 0;
+    int wordsPerHash = 0;
+    std::vector<uint64_t> words;
+
+    size_t size() const { return wordsPerHash ? words.size() / wordsPerHash : 0; }
+    const uint64_t* at(size_t i) const { return words.data() + i * wordsPerHash; }
+    void push(const uint64_t* hash) { words.insert(words.end(), hash, hash + wordsPerHash); }
+};
+
+PackedHashes makePackedHashes(int bits);
+int wordsForBits(int bits);
+
+// Hex conversion (same layout as vector1DToHex / imagehashlib's str(hash))
+bool hexToWords(const std::string& hex, uint64_t* out, int wordsPerHash);
+std::string wordsToHex(const uint64_t* hash, int bits);
+
+// Bits [start, start + length) of a packed hash, length <= 64
+uint64_t extractBits(const uint64_t* hash, int start, int length);
+
+inline int hammingDistance(const uint64_t* a, const uint64_t* b, int wordsPerHash) {
+    int distance = 0;
+    for (int w = 0; w < wordsPerHash; ++w)
+        distance += __builtin_popcountll(a[w] ^ b[w]);
+    return distance;
+}
+
+// I/O functions
+// Binary files start with "SJHASH01", then uint32 bits, uint32 reserved,
+// uint64 count and count * wordsPerHash native-endian words.
+// Anything else is read as text, one hex hash per line.
+PackedHashes readHashFile(const std::string& path);
+void writeHashFile(const std::string& path, const PackedHashes& hashes);
+
+#endif // HASHOPS_HPP
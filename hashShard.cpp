@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "hashShard.hpp"
+#include "concurrentHashIndex.hpp"
+
+namespace {
+
+void writeAll(int fd, const void* buffer, size_t size) {
+    const char* data = static_cast<const char*>(buffer);
+    while (size > 0) {
+        ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            throw std::runtime_error(std::string("Socket write failed: ") + std::strerror(errno));
+        data += written;
+        size -= written;
+    }
+}
+
+// false on a clean EOF before the first byte, throws on a short read
+bool readAll(int fd, void* buffer, size_t size) {
+    char* data = static_cast<char*>(buffer);
+    size_t total = size;
+    while (size > 0) {
+        ssize_t got = recv(fd, data, size, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got == 0 && size == total)
+            return false;
+        if (got <= 0)
+            throw std::runtime_error(std::string("Socket read failed: ") + std::strerror(errno));
+        data += got;
+        size -= got;
+    }
+    return true;
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("Socket path too long: " + path);
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+// Estado de um processo de shard: consultas, inserções e rebuilds rodam ao
+// mesmo tempo sobre o ConcurrentHashIndex, sem lock do lado das consultas
+struct ShardState {
+    std::string indexPath;
+    std::unique_ptr<ConcurrentHashIndex> index;
+
+    // The first call happens before any connection is accepted
+    size_t reload() {
+        HashIndex fresh = HashIndex::load(indexPath);
+        if (!index)
+            index = std::make_unique<ConcurrentHashIndex>(std::move(fresh));
+        else
+            index->reset(std::move(fresh));
+        return index->size();
+    }
+};
+
+void sendMatches(int fd, uint32_t status, uint32_t count, const std::vector<HashMatch>& matches) {
+    ShardResponse response{status, count};
+    std::vector<ShardMatch> wire(matches.size());
+    for (size_t i = 0; i < matches.size(); ++i)
+        wire[i] = {matches[i].id, static_cast<uint32_t>(matches[i].distance), 0};
+
+    writeAll(fd, &response, sizeof(response));
+    writeAll(fd, wire.data(), wire.size() * sizeof(ShardMatch));
+}
+
+// Far above any real hash (1024 words = 65536 bits); anything bigger is a
+// broken or hostile peer, and its payload can't be skipped safely either
+const uint32_t MAX_REQUEST_WORDS = 1024;
+
+void serveConnection(int fd, ShardState& state) {
+    try {
+        ShardRequest request;
+        std::vector<uint64_t> query;
+        while (readAll(fd, &request, sizeof(request))) {
+            if (request.words > MAX_REQUEST_WORDS) {
+                std::cerr << "ERROR: request with " << request.words << " words, closing the connection" << std::endl;
+                break;
+            }
+            query.resize(request.words);
+            if (request.words > 0 && !readAll(fd, query.data(), query.size() * sizeof(uint64_t)))
+                break;
+
+            ConcurrentHashIndex* index = state.index.get();
+            switch (static_cast<ShardOp>(request.op)) {
+            case ShardOp::Radius:
+            case ShardOp::Knn: {
+                if (static_cast<int>(request.words) != index->wordsPerHash()) {
+                    sendMatches(fd, 1, 0, {});
+                    break;
+                }
+                auto matches = static_cast<ShardOp>(request.op) == ShardOp::Radius
+                    ? index->radiusQuery(query.data(), static_cast<int>(request.param))
+                    : index->knnQuery(query.data(), request.param);
+                sendMatches(fd, 0, static_cast<uint32_t>(matches.size()), matches);
+                break;
+            }
+            case ShardOp::Rebuild:
+                try {
+                    sendMatches(fd, 0, static_cast<uint32_t>(state.reload()), {});
+                } catch (const std::exception& e) {
+                    std::cerr << "ERROR: rebuild of " << state.indexPath << " failed: " << e.what() << std::endl;
+                    sendMatches(fd, 1, static_cast<uint32_t>(index->size()), {});
+                }
+                break;
+            case ShardOp::Stats:
+                sendMatches(fd, 0, static_cast<uint32_t>(index->size()), {});
+                break;
+            case ShardOp::Bits:
+                sendMatches(fd, 0, static_cast<uint32_t>(index->bits()), {});
+                break;
+            case ShardOp::Insert:
+                if (static_cast<int>(request.words) != index->wordsPerHash() + 1) {
+                    sendMatches(fd, 1, 0, {});
+                    break;
+                }
+                index->add(query[0], query.data() + 1);
+                sendMatches(fd, 0, static_cast<uint32_t>(index->size()), {});
+                break;
+            default:
+                sendMatches(fd, 1, 0, {});
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+    }
+    close(fd);
+}
+
+} // namespace
+
+std::string shardPath(const std::string& prefix, int shard) {
+    return prefix + "." + std::to_string(shard) + ".idx";
+}
+
+void buildShards(const PackedHashes& hashes, int shards, const std::string& prefix) {
+    if (shards < 1)
+        throw std::invalid_argument("The shard count must be >= 1");
+
+    std::vector<std::thread> writers;
+    std::vector<std::string> errors(shards);
+    for (int s = 0; s < shards; ++s) {
+        writers.emplace_back([&, s] {
+            try {
+                HashIndex index(hashes.bits);
+                index.reserve(hashes.size() / shards + 1);
+                for (size_t i = s; i < hashes.size(); i += shards)
+                    index.add(i, hashes.at(i));
+                index.save(shardPath(prefix, s));
+            } catch (const std::exception& e) {
+                errors[s] = e.what();
+            }
+        });
+    }
+    for (auto& writer : writers)
+        writer.join();
+
+    for (const auto& error : errors)
+        if (!error.empty())
+            throw std::runtime_error(error);
+}
+
+void serveShard(const std::string& indexPath, const std::string& socketPath) {
+    signal(SIGPIPE, SIG_IGN);
+
+    ShardState state;
+    state.indexPath = indexPath;
+    state.reload();
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+
+    sockaddr_un address = socketAddress(socketPath);
+    unlink(socketPath.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 64) < 0) {
+        close(listener);
+        throw std::runtime_error("Can't listen on " + socketPath + ": " + std::strerror(errno));
+    }
+
+    std::cerr << "Shard " << indexPath << " (" << state.index->size() << " hashes) on " << socketPath << std::endl;
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            close(listener);
+            throw std::runtime_error(std::string("accept: ") + std::strerror(errno));
+        }
+        std::thread(serveConnection, fd, std::ref(state)).detach();
+    }
+}
+
+ShardCoordinator::ShardCoordinator(const std::vector<std::string>& socketPaths)
+    : paths(socketPaths) {
+    for (const auto& path : paths) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = socketAddress(path);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            std::string error = std::strerror(errno);
+            if (fd >= 0)
+                close(fd);
+            for (int open : sockets)
+                close(open);
+            throw std::runtime_error("Can't connect to shard " + path + ": " + error);
+        }
+        sockets.push_back(fd);
+    }
+}
+
+ShardCoordinator::~ShardCoordinator() {
+    for (int fd : sockets)
+        if (fd >= 0)
+            close(fd);
+}
+
+// A connection that failed mid-request may still have a reply in flight:
+// it is closed and opened again on next use instead of being read from
+int ShardCoordinator::connection(size_t shard) {
+    if (sockets[shard] >= 0)
+        return sockets[shard];
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = socketAddress(paths[shard]);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::string error = std::strerror(errno);
+        if (fd >= 0)
+            close(fd);
+        throw std::runtime_error("Can't reconnect to shard " + paths[shard] + ": " + error);
+    }
+    sockets[shard] = fd;
+    return fd;
+}
+
+void ShardCoordinator::dropConnection(size_t shard) {
+    if (sockets[shard] >= 0)
+        close(sockets[shard]);
+    sockets[shard] = -1;
+}
+
+// Reads one shard's answer to a request already sent on its socket
+ShardResponse ShardCoordinator::readResponse(size_t shard, ShardOp op, std::vector<ShardMatch>& wire) {
+    ShardResponse response;
+    if (!readAll(sockets[shard], &response, sizeof(response)))
+        throw std::runtime_error("Shard " + paths[shard] + " closed the connection");
+
+    size_t entries = (op == ShardOp::Radius || op == ShardOp::Knn) ? response.count : 0;
+    wire.resize(entries);
+    if (entries > 0 && !readAll(sockets[shard], wire.data(), entries * sizeof(ShardMatch)))
+        throw std::runtime_error("Shard " + paths[shard] + " closed the connection");
+    return response;
+}
+
+std::vector<std::vector<HashMatch>> ShardCoordinator::fanOut(ShardOp op, uint32_t param, const uint64_t* query,
+                                                             int words, std::vector<uint32_t>* counts) {
+    std::lock_guard<std::mutex> lock(queryMutex);
+
+    // Envia para todos antes de ler qualquer resposta: os shards trabalham em
+    // paralelo e a latência total fica sendo a do shard mais lento
+    ShardRequest request{static_cast<uint32_t>(op), param, static_cast<uint32_t>(words), 0};
+    std::vector<bool> sent(sockets.size(), false);
+    std::string failed;
+    for (size_t s = 0; s < sockets.size(); ++s) {
+        try {
+            int fd = connection(s);
+            writeAll(fd, &request, sizeof(request));
+            writeAll(fd, query, words * sizeof(uint64_t));
+            sent[s] = true;
+        } catch (const std::exception& e) {
+            dropConnection(s);
+            failed += (failed.empty() ? "" : ", ") + std::string(e.what());
+        }
+    }
+
+    // Every reply that was asked for is read, even after a failure, so no
+    // connection is left holding a stale answer for the next query
+    std::vector<std::vector<HashMatch>> partial(sockets.size());
+    std::vector<ShardMatch> wire;
+    for (size_t s = 0; s < sockets.size(); ++s) {
+        if (!sent[s])
+            continue;
+        ShardResponse response;
+        try {
+            response = readResponse(s, op, wire);
+        } catch (const std::exception& e) {
+            dropConnection(s);
+            failed += (failed.empty() ? "" : ", ") + std::string(e.what());
+            continue;
+        }
+        if (response.status != 0)
+            failed += (failed.empty() ? "" : ", ") + paths[s] + " returned an error";
+        if (counts)
+            counts->push_back(response.count);
+        for (const auto& match : wire)
+            partial[s].push_back({match.id, static_cast<int>(match.distance)});
+    }
+
+    if (!failed.empty())
+        throw std::runtime_error("Shard request failed: " + failed);
+    return partial;
+}
+
+std::vector<HashMatch> ShardCoordinator::radiusQuery(const uint64_t* query, int words, int radius) {
+    std::vector<HashMatch> merged;
+    for (auto& partial : fanOut(ShardOp::Radius, static_cast<uint32_t>(radius), query, words))
+        merged.insert(merged.end(), partial.begin(), partial.end());
+    std::sort(merged.begin(), merged.end());
+    return merged;
+}
+
+std::vector<HashMatch> ShardCoordinator::knnQuery(const uint64_t* query, int words, size_t k) {
+    std::vector<HashMatch> merged;
+    for (auto& partial : fanOut(ShardOp::Knn, static_cast<uint32_t>(k), query, words))
+        merged.insert(merged.end(), partial.begin(), partial.end());
+
+    // Cada shard já devolve seus k melhores; o global está entre eles
+    size_t keep = std::min(k, merged.size());
+    std::partial_sort(merged.begin(), merged.begin() + keep, merged.end());
+    merged.resize(keep);
+    return merged;
+}
+
+void ShardCoordinator::insert(uint64_t id, const uint64_t* hash, int words) {
+    std::lock_guard<std::mutex> lock(queryMutex);
+
+    size_t shard = id % sockets.size();
+    std::vector<uint64_t> payload(1 + words);
+    payload[0] = id;
+    std::copy(hash, hash + words, payload.begin() + 1);
+
+    ShardRequest request{static_cast<uint32_t>(ShardOp::Insert), 0, static_cast<uint32_t>(payload.size()), 0};
+    std::vector<ShardMatch> wire;
+    ShardResponse response;
+    try {
+        int fd = connection(shard);
+        writeAll(fd, &request, sizeof(request));
+        writeAll(fd, payload.data(), payload.size() * sizeof(uint64_t));
+        response = readResponse(shard, ShardOp::Insert, wire);
+    } catch (...) {
+        dropConnection(shard);
+        throw;
+    }
+    if (response.status != 0)
+        throw std::runtime_error("Insert failed on shard " + paths[shard]);
+}
+
+size_t ShardCoordinator::rebuild() {
+    std::vector<uint32_t> counts;
+    fanOut(ShardOp::Rebuild, 0, nullptr, 0, &counts);
+
+    size_t total = 0;
+    for (uint32_t count : counts)
+        total += count;
+    return total;
+}
+
+size_t ShardCoordinator::totalHashes() {
+    std::vector<uint32_t> counts;
+    fanOut(ShardOp::Stats, 0, nullptr, 0, &counts);
+
+    size_t total = 0;
+    for (uint32_t count : counts)
+        total += count;
+    return total;
+}
+
+int ShardCoordinator::hashBits() {
+    std::vector<uint32_t> counts;
+    fanOut(ShardOp::Bits, 0, nullptr, 0, &counts);
+
+    for (size_t s = 1; s < counts.size(); ++s)
+        if (counts[s] != counts[0])
+            throw std::runtime_error("Shards " + paths[0] + " and " + paths[s] + " hold hashes of different sizes");
+    return counts.empty() ? 0 : static_cast<int>(counts[0]);
+}
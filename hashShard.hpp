@@ -0,0 +1,91 @@
+#ifndef HASHSHARD_HPP
+#define HASHSHARD_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "hashOps.hpp"
+#include "hashIndex.hpp"
+
+// Wire protocol between the coordinator and the shard processes, over
+// local (AF_UNIX) stream sockets. Both ends live on the same machine, so
+// integers go out in native byte order.
+enum class ShardOp : uint32_t {
+    Radius = 1,   // param = radius
+    Knn = 2,      // param = k
+    Rebuild = 3,  // reload the shard file from disk
+    Stats = 4,    // count = number of hashes held by the shard
+    Insert = 5,   // words = id followed by the hash; count = new shard size
+    Bits = 6,     // count = bits per hash held by the shard
+};
+
+struct ShardRequest {
+    uint32_t op;
+    uint32_t param;
+    uint32_t words; // query words following this header
+    uint32_t reserved;
+};
+
+struct ShardResponse {
+    uint32_t status; // 0 = ok
+    uint32_t count;  // ShardMatch entries following this header
+};
+
+struct ShardMatch {
+    uint64_t id;
+    uint32_t distance;
+    uint32_t reserved;
+};
+
+// Path of shard `shard` for a given prefix: "<prefix>.<shard>.idx"
+std::string shardPath(const std::string& prefix, int shard);
+
+// Splits a corpus into `shards` index files by id % shards, one writer
+// thread per shard. Ids are the positions in `hashes`.
+void buildShards(const PackedHashes& hashes, int shards, const std::string& prefix);
+
+// Blocks serving one shard file on `socketPath`, one thread per connection.
+// Queries keep running during inserts and rebuilds (see ConcurrentHashIndex).
+// Inserted hashes live in memory only: a rebuild goes back to the file.
+void serveShard(const std::string& indexPath, const std::string& socketPath);
+
+// Fans a query out to every shard at once and merges the partial results.
+// Connections are kept open between queries; one query runs at a time. A
+// shard that fails mid-request is reconnected on the next call.
+class ShardCoordinator {
+public:
+    explicit ShardCoordinator(const std::vector<std::string>& socketPaths);
+    ~ShardCoordinator();
+
+    ShardCoordinator(const ShardCoordinator&) = delete;
+    ShardCoordinator& operator=(const ShardCoordinator&) = delete;
+
+    std::vector<HashMatch> radiusQuery(const uint64_t* query, int words, int radius);
+    std::vector<HashMatch> knnQuery(const uint64_t* query, int words, size_t k);
+
+    // Adds one hash to shard id % shardCount(), the same split as buildShards()
+    void insert(uint64_t id, const uint64_t* hash, int words);
+
+    // All shards reload their files concurrently; returns the total hash count
+    size_t rebuild();
+    size_t totalHashes();
+    // Hash size of the shards; throws when they don't all agree
+    int hashBits();
+
+    size_t shardCount() const { return sockets.size(); }
+
+private:
+    int connection(size_t shard);
+    void dropConnection(size_t shard);
+    ShardResponse readResponse(size_t shard, ShardOp op, std::vector<ShardMatch>& wire);
+    std::vector<std::vector<HashMatch>> fanOut(ShardOp op, uint32_t param, const uint64_t* query, int words,
+                                               std::vector<uint32_t>* counts = nullptr);
+
+    std::vector<std::string> paths;
+    std::vector<int> sockets;
+    std::mutex queryMutex;
+};
+
+#endif // HASHSHARD_HPP
@@ -0,0 +1,21 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdlib.h>
+
+/* Interleaved 8-bit pixels, row after row (RGB from jpeg.c, RGBA from png.c) */
+typedef struct {
+    unsigned char *data;
+    int width;
+    int height;
+    int channels;
+} Image;
+
+static inline void free_image(Image *img) {
+    if (img != NULL) {
+        free(img->data);
+        free(img);
+    }
+}
+
+#endif /* IMAGE_H */
@@ -0,0 +1,194 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "imageHash.hpp"
+#include "vectorOps.hpp"
+#include "jpegReader.h"
+#include "mappedFile.h"
+
+// Same role as PIL's convert('L'): imread gives BGR(A), the hashes want luma
+static cv::Mat toGrayscale(const cv::Mat& image) {
+    cv::Mat grayscale;
+    if (image.channels() == 3) {
+        cv::cvtColor(image, grayscale, cv::COLOR_BGR2GRAY);
+    } else if (image.channels() == 4) {
+        cv::cvtColor(image, grayscale, cv::COLOR_BGRA2GRAY);
+    } else {
+        grayscale = image;
+    }
+    return grayscale;
+}
+
+std::string averageHash(const cv::Mat& image, int hashSize, std::function<double(Vector2D)> meanFunc) {
+    if(hashSize < 2)
+        throw std::invalid_argument("The hash size must be >= 2");
+    if (image.empty())
+        throw std::invalid_argument("Can't hash an empty image");
+
+    // reduce size and complexity, then convert to grayscale
+    cv::Mat resizeImage;
+    cv::resize(toGrayscale(image), resizeImage, cv::Size(hashSize, hashSize), 0.0, 0.0, cv::INTER_LANCZOS4);
+
+    Vector2D pixels = matGSToVector2D(resizeImage);
+    double meanFuncReturn = meanFunc(pixels); // Average of pixels in the resized image
+
+    // diff = pixels > avg
+    Vector2D diff = zeroesVector2D(hashSize, hashSize);
+    for (int i = 0; i < hashSize; i++) {
+        for (int j = 0; j < hashSize; j++) {
+            diff[i][j] = pixels[i][j] > meanFuncReturn;
+        }
+    }
+
+    return vector1DToHex(flattenVector2D(diff));
+}
+
+// Like numpy.median: mean of the two middle values when the size is even
+static double medianOf(std::vector<double> values) {
+    size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    double upper = values[mid];
+    if (values.size() % 2 != 0)
+        return upper;
+    double lower = *std::max_element(values.begin(), values.begin() + mid);
+    return (lower + upper) / 2.0;
+}
+
+// Low frequencies of the 2D DCT of a square grayscale image, thresholded at their median
+static std::string dctHash(const cv::Mat& square, int hashSize) {
+    cv::Mat pixels, dct;
+    square.convertTo(pixels, CV_64F);
+    cv::dct(pixels, dct);
+
+    // cv::dct é ortonormal, o scipy.fftpack.dct do imagehashlib não: em relação
+    // aos outros termos, a primeira linha e a primeira coluna saem sqrt(2) maiores
+    std::vector<double> lowfreq(hashSize * hashSize);
+    for (int i = 0; i < hashSize; i++) {
+        for (int j = 0; j < hashSize; j++) {
+            double scale = (i == 0 ? M_SQRT2 : 1.0) * (j == 0 ? M_SQRT2 : 1.0);
+            lowfreq[i * hashSize + j] = dct.at<double>(i, j) * scale;
+        }
+    }
+
+    double med = medianOf(lowfreq);
+    Vector1D diff(lowfreq.size());
+    for (size_t k = 0; k < lowfreq.size(); k++)
+        diff[k] = lowfreq[k] > med;
+
+    return vector1DToHex(diff);
+}
+
+std::string perceptualHash(const cv::Mat& image, int hashSize, int highfreqFactor) {
+    if(hashSize < 2)
+        throw std::invalid_argument("The hash size must be >= 2");
+    if (image.empty())
+        throw std::invalid_argument("Can't hash an empty image");
+
+    int imgSize = hashSize * highfreqFactor;
+    cv::Mat resizeImage;
+    cv::resize(toGrayscale(image), resizeImage, cv::Size(imgSize, imgSize), 0.0, 0.0, cv::INTER_LANCZOS4);
+
+    return dctHash(resizeImage, hashSize);
+}
+
+std::string perceptualHashJpegData(const unsigned char* data, size_t size, const std::string& name, int hashSize, int highfreqFactor) {
+    if(hashSize < 2)
+        throw std::invalid_argument("The hash size must be >= 2");
+
+    int imgSize = hashSize * highfreqFactor;
+    bool isJpeg = size > 2 && data[0] == 0xFF && data[1] == 0xD8;
+    Image* luma = isJpeg ? read_jpeg_dct_luma(data, size, 0) : nullptr;
+
+    if (luma != nullptr) {
+        // O decode normal gira a imagem conforme o EXIF; a grade de luma gira igual
+        JpegExifInfo info;
+        int orientation = read_jpeg_exif(data, size, &info) == 0 ? info.orientation : 1;
+
+        // A imagem de luma já é uma média por blocos, INTER_AREA só termina a redução
+        cv::Mat gray = applyExifOrientation(cv::Mat(luma->height, luma->width, CV_8UC1, luma->data), orientation);
+        cv::Mat resizeImage;
+        cv::resize(gray, resizeImage, cv::Size(imgSize, imgSize), 0.0, 0.0, cv::INTER_AREA);
+        free_image(luma);
+        return dctHash(resizeImage, hashSize);
+    }
+
+    // Not a (YCbCr/grayscale) JPEG: decode the same bytes the usual way
+    cv::Mat image = decodeImageMat(data, size, name);
+    return image.empty() ? "" : perceptualHash(image, hashSize, highfreqFactor);
+}
+
+std::string perceptualHashJpeg(const std::string& path, int hashSize, int highfreqFactor) {
+    MappedFile file;
+    if (map_file(path.c_str(), &file) != 0)
+        return "";
+
+    std::string hash;
+    try {
+        hash = perceptualHashJpegData(file.data, file.size, path, hashSize, highfreqFactor);
+    } catch (...) {
+        unmap_file(&file);
+        throw;
+    }
+    if (file.truncated) {
+        std::cerr << "ERROR: " << path << " was truncated while it was being read" << std::endl;
+        hash.clear();
+    }
+    unmap_file(&file);
+    return hash;
+}
+
+bool isKnownHashType(const std::string& type) {
+    return type == "ahash" || type == "phash" || type == "phash-dct";
+}
+
+std::string hashImage(const cv::Mat& image, const std::string& type, int hashSize) {
+    if (type == "ahash")
+        return averageHash(image, hashSize);
+    // Pixels already decoded: the coefficient shortcut has nothing left to save
+    if (type == "phash" || type == "phash-dct")
+        return perceptualHash(image, hashSize);
+
+    throw std::invalid_argument("Unknown hash type: " + type);
+}
+
+// Side of the square the hash resizes its input to
+static int hashInputSize(const std::string& type, int hashSize) {
+    return type == "ahash" ? hashSize : hashSize * 4;
+}
+
+std::string hashImageFile(const std::string& path, const std::string& type, int hashSize, bool mapped, bool exifThumbnail) {
+    if (exifThumbnail) {
+        cv::Mat image = readImageMatThumbnail(path, hashInputSize(type, hashSize));
+        return image.empty() ? "" : hashImage(image, type, hashSize);
+    }
+    if (type == "phash-dct")
+        return perceptualHashJpeg(path, hashSize);
+
+    cv::Mat image = mapped ? readImageMatMapped(path) : readImageMat(path);
+    if (image.empty())
+        return "";
+    return hashImage(image, type, hashSize);
+}
+
+std::string hashImageData(const unsigned char* data, size_t size, const std::string& name, const std::string& type, int hashSize,
+                          bool exifThumbnail) {
+    if (exifThumbnail) {
+        cv::Mat image = decodeImageMatThumbnail(data, size, name, hashInputSize(type, hashSize));
+        return image.empty() ? "" : hashImage(image, type, hashSize);
+    }
+    if (type == "phash-dct")
+        return perceptualHashJpegData(data, size, name, hashSize);
+
+    cv::Mat image = decodeImageMat(data, size, name);
+    if (image.empty())
+        return "";
+    return hashImage(image, type, hashSize);
+}
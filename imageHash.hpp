@@ -0,0 +1,36 @@
+#ifndef IMAGEHASH_HPP
+#define IMAGEHASH_HPP
+
+#include <opencv2/core/core.hpp>
+#include <functional>
+#include <string>
+
+#include "vectorOps.hpp"
+
+// Hash functions
+// The hex output is the same as str() of an ImageHash in imagehashlib.py
+std::string averageHash(const cv::Mat& image, int hashSize=8, std::function<double(Vector2D)> meanFunc=meanVector2D);
+std::string perceptualHash(const cv::Mat& image, int hashSize=8, int highfreqFactor=4);
+
+// pHash of a JPEG built from its luma DCT coefficients, never running an
+// inverse DCT over the image. The EXIF orientation is applied to the luma
+// grid, as imread/imdecode do, so rotated camera JPEGs hash like "phash"
+// sees them. Other files fall back to perceptualHash().
+// Returns "" when the file can't be read or decoded.
+std::string perceptualHashJpeg(const std::string& path, int hashSize=8, int highfreqFactor=4);
+std::string perceptualHashJpegData(const unsigned char* data, size_t size, const std::string& name, int hashSize=8,
+                                   int highfreqFactor=4);
+
+// Dispatch by name ("ahash", "phash", "phash-dct"), used by the command line tools
+bool isKnownHashType(const std::string& type);
+std::string hashImage(const cv::Mat& image, const std::string& type, int hashSize=8);
+// Reads and hashes one file, "" when it can't be read. exifThumbnail hashes
+// the embedded camera thumbnail when it is big enough (readImageMatThumbnail).
+std::string hashImageFile(const std::string& path, const std::string& type, int hashSize=8, bool mapped=false,
+                          bool exifThumbnail=false);
+// Same for an encoded image already in memory, e.g. an archive member;
+// `name` only labels the error messages
+std::string hashImageData(const unsigned char* data, size_t size, const std::string& name, const std::string& type,
+                          int hashSize=8, bool exifThumbnail=false);
+
+#endif // IMAGEHASH_HPP
@@ -248,18 +248,13 @@ def average_hash(image, hash_size=8, mean=numpy.mean):
 	# reduce size and complexity, then convert to grayscale
 	image = image.convert('L').resize((hash_size, hash_size), ANTIALIAS)
 
-	image.save("pringles.jpg")
 	# find average pixel value; 'pixels' is an array of the pixel values, ranging from 0 (black) to 255 (white)
 	pixels = numpy.asarray(image)
-	print(pixels.shape)
-	print(pixels)
 	avg = mean(pixels)
-	print(avg)
 
 	# create string of bits
 	diff = pixels > avg
 	# make a hash
-	print(diff)
 	return ImageHash(diff)
 
 
@@ -541,12 +536,221 @@ class ImageMultiHash:
 		:param bit_error_rate: Percentage of bits which can be incorrect, an alternative to the hamming cutoff.
 		Defaults to 0.25 if unset, which means the hash can be 25% different
 		"""
+		if isinstance(other_hashes, ImageMultiHashIndex):
+			return other_hashes.best_match(self, hamming_cutoff, bit_error_rate)
 		return min(
 			other_hashes,
 			key=lambda other_hash: self.__sub__(other_hash, hamming_cutoff, bit_error_rate)
 		)
 
 
+# number of set bits for every byte value
+_BYTE_BIT_COUNTS = numpy.array([bin(i).count('1') for i in range(256)], dtype=numpy.int32)
+
+
+class ImageMultiHashIndex:
+	"""
+	Inverted index over the segment hashes of many ImageMultiHash objects, for crop resistant search at corpus scale.
+
+	Every segment hash is stored packed, next to the position of the multi-hash that owns it, and is also keyed by
+	its value in each of a few bands of band_bits bits (multi-index hashing). Two segments within a hamming distance
+	t differ by at most t // bands bits in at least one band, so a query only verifies the segments filed under band
+	keys that close to its own, found by scanning the distinct keys of each band rather than the segments. It then
+	counts the matching regions per owning image and only applies the region_cutoff / hamming_cutoff rules to that
+	shortlist. Results are the same as calling ImageMultiHash.matches / ImageMultiHash.best_match against every
+	indexed hash, in insertion order.
+	"""
+
+	# bits per band: at most 2**16 distinct keys to scan per band, however many segments are indexed
+	band_bits = 16
+
+	def __init__(self, multihashes=None):
+		# type: (list[ImageMultiHash] | None) -> None
+		self.multihashes = []  # type: list[ImageMultiHash]
+		self._pending = []  # type: list[tuple[int, ImageHash]]
+		self._segments = None  # type: numpy.ndarray | None
+		self._owners = numpy.zeros(0, dtype=numpy.int64)
+		self._segment_bits = None  # type: int | None
+		# per band: (bit range, sorted distinct keys, start of each key's rows in members, members)
+		self._bands = []  # type: list[tuple[slice, numpy.ndarray, numpy.ndarray, numpy.ndarray]]
+		self._keys = None  # type: numpy.ndarray | None
+		for multihash in multihashes or []:
+			self.add(multihash)
+
+	def __len__(self):
+		return len(self.multihashes)
+
+	def add(self, multihash):
+		# type: (ImageMultiHash) -> int
+		"""
+		Adds a multi-hash to the index and returns its position.
+		"""
+		for segment_hash in multihash.segment_hashes:
+			if self._segment_bits is None:
+				self._segment_bits = len(segment_hash)
+			elif len(segment_hash) != self._segment_bits:
+				raise TypeError('ImageHashes must be of the same shape.', self._segment_bits, len(segment_hash))
+		position = len(self.multihashes)
+		self.multihashes.append(multihash)
+		self._pending.extend((position, segment_hash) for segment_hash in multihash.segment_hashes)
+		return position
+
+	def _packed(self, segment_hashes):
+		return numpy.array([numpy.packbits(h.hash.flatten()) for h in segment_hashes], dtype=numpy.uint8)
+
+	def _band_ranges(self):
+		bands = max(1, self._segment_bits // self.band_bits)
+		return [slice(self._segment_bits * b // bands, self._segment_bits * (b + 1) // bands) for b in range(bands)]
+
+	def _band_keys(self, segment_hashes):
+		"""
+		Key of every segment in every band, shape (segments, bands). Bands are under 32 bits wide.
+		"""
+		bits = numpy.array([h.hash.flatten() for h in segment_hashes], dtype=numpy.int64)
+		keys = []
+		for band in self._band_ranges():
+			weights = numpy.left_shift(1, numpy.arange(band.stop - band.start - 1, -1, -1, dtype=numpy.int64))
+			keys.append(bits[:, band].dot(weights))
+		return numpy.stack(keys, axis=1)
+
+	def _flush(self):
+		if not self._pending:
+			return
+		packed = self._packed([h for _, h in self._pending])
+		owners = numpy.array([owner for owner, _ in self._pending], dtype=numpy.int64)
+		keys = self._band_keys([h for _, h in self._pending])
+		self._segments = packed if self._segments is None else numpy.concatenate([self._segments, packed])
+		self._owners = numpy.concatenate([self._owners, owners])
+		self._keys = keys if self._keys is None else numpy.concatenate([self._keys, keys])
+		self._pending = []
+
+		# rows grouped by key, one group per distinct key, like the sorted band buckets of hashCluster
+		self._bands = []
+		for b, band in enumerate(self._band_ranges()):
+			members = numpy.argsort(self._keys[:, b], kind='stable')
+			distinct, starts = numpy.unique(self._keys[members, b], return_index=True)
+			starts = numpy.append(starts, len(members))
+			self._bands.append((band, distinct, starts, members))
+
+	def _candidates(self, query_keys, radius):
+		# type: (numpy.ndarray, int) -> numpy.ndarray
+		"""
+		Rows with a band key within `radius` bits of the query's key in the same band, for at least one band.
+		"""
+		rows = []
+		for b, (_, distinct, starts, members) in enumerate(self._bands):
+			xor = numpy.bitwise_xor(distinct, query_keys[b]).astype('<u4')
+			near = numpy.nonzero(_BYTE_BIT_COUNTS[xor.view(numpy.uint8)].reshape(-1, 4).sum(axis=1) <= radius)[0]
+			if len(near) == 0:
+				continue
+			# concatenation of members[starts[k]:starts[k + 1]] for every near key k
+			lengths = starts[near + 1] - starts[near]
+			first = numpy.repeat(starts[near] - numpy.cumsum(lengths) + lengths, lengths)
+			rows.append(members[first + numpy.arange(lengths.sum())])
+		if not rows:
+			return numpy.zeros(0, dtype=numpy.int64)
+		return numpy.unique(numpy.concatenate(rows))
+
+	def _segment_hits(self, query, hamming_cutoff):
+		# type: (ImageMultiHash, float) -> tuple[numpy.ndarray, numpy.ndarray, numpy.ndarray]
+		"""
+		Returns (query segment, owner, distance) for every indexed segment within the cutoff.
+		"""
+		self._flush()
+		empty = numpy.zeros(0, dtype=numpy.int64)
+		if self._segments is None or not query.segment_hashes:
+			return empty, empty, empty
+		if len(query.segment_hashes[0]) != self._segment_bits:
+			raise TypeError('ImageHashes must be of the same shape.', len(query.segment_hashes[0]), self._segment_bits)
+
+		if hamming_cutoff < 0:
+			return empty, empty, empty
+
+		# pigeonhole over the bands: within the cutoff means within cutoff // bands in some band
+		radius = int(numpy.floor(hamming_cutoff)) // len(self._bands)
+		queries = self._packed(query.segment_hashes)
+		query_keys = self._band_keys(query.segment_hashes)
+		hit_queries, hit_owners, hit_distances = [empty], [empty], [empty]
+		for q in range(len(queries)):
+			rows = self._candidates(query_keys[q], radius)
+			distances = _BYTE_BIT_COUNTS[numpy.bitwise_xor(self._segments[rows], queries[q])].sum(axis=1)
+			rows, distances = rows[distances <= hamming_cutoff], distances[distances <= hamming_cutoff]
+			hit_queries.append(numpy.full(len(rows), q, dtype=numpy.int64))
+			hit_owners.append(self._owners[rows])
+			hit_distances.append(distances.astype(numpy.int64))
+		return numpy.concatenate(hit_queries), numpy.concatenate(hit_owners), numpy.concatenate(hit_distances)
+
+	def hash_diffs(self, query, hamming_cutoff=None, bit_error_rate=None):
+		# type: (ImageMultiHash, float | None, float | None) -> dict[int, tuple[int, int]]
+		"""
+		Shortlist of the indexed hashes sharing at least one matching region with `query`, as a dict from position to
+		query.hash_diff(indexed_hash). Positions missing from the dict have no matching region.
+		:param query: The image multi hash to look up
+		:param hamming_cutoff: The maximum hamming distance to a region hash in the target hash
+		:param bit_error_rate: Percentage of bits which can be incorrect, an alternative to the hamming cutoff. The
+		default of 0.25 means that the segment hashes can be up to 25% different
+		"""
+		if hamming_cutoff is None:
+			if bit_error_rate is None:
+				bit_error_rate = 0.25
+			hamming_cutoff = len(query.segment_hashes[0]) * bit_error_rate
+		q, owners, distances = self._segment_hits(query, hamming_cutoff)
+		if len(q) == 0:
+			return {}
+
+		# lowest distance per (query segment, owner), like the min() in hash_diff
+		order = numpy.lexsort((distances, owners, q))
+		q, owners, distances = q[order], owners[order], distances[order]
+		first = numpy.ones(len(q), dtype=bool)
+		first[1:] = (q[1:] != q[:-1]) | (owners[1:] != owners[:-1])
+		owners, distances = owners[first], distances[first]
+
+		# one entry left per matching region: count them and sum their distances per owner
+		shortlist, slots = numpy.unique(owners, return_inverse=True)
+		matches = numpy.bincount(slots)
+		sums = numpy.bincount(slots, weights=distances)
+		return {int(o): (int(m), int(d)) for o, m, d in zip(shortlist, matches, sums)}
+
+	def matches(self, query, region_cutoff=1, hamming_cutoff=None, bit_error_rate=None):
+		# type: (ImageMultiHash, int, float | None, float | None) -> list[ImageMultiHash]
+		"""
+		Returns the indexed hashes for which query.matches(indexed_hash) holds, in insertion order.
+		:param query: The image multi hash to look up
+		:param region_cutoff: The minimum number of regions which must have a matching hash
+		:param hamming_cutoff: The maximum hamming distance to a region hash in the target hash
+		:param bit_error_rate: Percentage of bits which can be incorrect, an alternative to the hamming cutoff. The
+		default of 0.25 means that the segment hashes can be up to 25% different
+		"""
+		if region_cutoff <= 0:
+			# every hash matches without a single region, no shortlist possible
+			return list(self.multihashes)
+		diffs = self.hash_diffs(query, hamming_cutoff, bit_error_rate)
+		return [self.multihashes[p] for p in sorted(diffs) if diffs[p][0] >= region_cutoff]
+
+	def best_match(self, query, hamming_cutoff=None, bit_error_rate=None):
+		# type: (ImageMultiHash, float | None, float | None) -> ImageMultiHash
+		"""
+		Returns the indexed hash which is the best match to `query`, same as query.best_match(all indexed hashes).
+		:param query: The image multi hash to look up
+		:param hamming_cutoff: The maximum hamming distance to a region hash in the target hash
+		:param bit_error_rate: Percentage of bits which can be incorrect, an alternative to the hamming cutoff.
+		Defaults to 0.25 if unset, which means the hash can be 25% different
+		"""
+		if not self.multihashes:
+			raise ValueError('best_match() on an empty index')
+		max_difference = len(query.segment_hashes)
+		best_position, best_score = 0, max_difference
+		for position, (matches, sum_distance) in sorted(self.hash_diffs(query, hamming_cutoff, bit_error_rate).items()):
+			# same arithmetic as ImageMultiHash.__sub__, so ties break the same way
+			max_distance = matches * len(query.segment_hashes[0])
+			tie_breaker = 0 - (float(sum_distance) / max_distance)
+			score = max_difference - (matches + tie_breaker)
+			if score < best_score:
+				best_position, best_score = position, score
+		# hashes left out of the shortlist all score max_difference, and min() keeps the first of equal keys
+		return self.multihashes[best_position]
+
+
 def _find_region(remaining_pixels, segmented_pixels):
 	"""
 	Finds a region and returns a set of pixel coordinates for it.
@@ -1,35 +1,59 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <setjmp.h>
 #include <jpeglib.h>
 #include <jerror.h>
 
+#include "jpegReader.h"
+#include "mappedFile.h"
+
+/* Not part of strict C99 <math.h> */
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+#ifndef M_SQRT1_2
+#define M_SQRT1_2 0.70710678118654752440
+#endif
+
 // sudo apt install libjpeg-dev
 // https://github.com/LuaDist/libjpeg/blob/master/example.c
 // https://stackoverflow.com/questions/5616216/need-help-in-reading-jpeg-file-using-libjpeg
 
+/* libjpeg's default error_exit() calls exit(): jump back to the decoder instead */
 typedef struct {
-    unsigned char *data;
-    int width;
-    int height;
-    int channels;
-} Image;
+    struct jpeg_error_mgr pub;
+    jmp_buf setjmp_buffer;
+} JpegErrorManager;
 
-/* Function to read a JPEG file and return an Image struct */
-Image* read_jpeg(const char *filename) {
+static void jpeg_error_exit(j_common_ptr cinfo) {
+    JpegErrorManager *err = (JpegErrorManager*)cinfo->err;
+    (*cinfo->err->output_message)(cinfo);
+    longjmp(err->setjmp_buffer, 1);
+}
+
+/* Decodes from a stdio stream when infile is set, otherwise from buffer */
+static Image* decode_jpeg(FILE *infile, const unsigned char *buffer, size_t size) {
     struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    FILE *infile;
+    JpegErrorManager jerr;
     JSAMPROW row_pointer[1];
-    Image *img = NULL;
+    Image * volatile img = NULL; /* volatile: must survive the longjmp */
 
-    if ((infile = fopen(filename, "rb")) == NULL) {
-        fprintf(stderr, "Can't open %s\n", filename);
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpeg_error_exit;
+    if (setjmp(jerr.setjmp_buffer)) {
+        /* Arquivo corrompido: libera tudo e devolve NULL em vez de matar o processo */
+        jpeg_destroy_decompress(&cinfo);
+        free_image(img);
         return NULL;
     }
 
-    cinfo.err = jpeg_std_error(&jerr);
     jpeg_create_decompress(&cinfo);
-    jpeg_stdio_src(&cinfo, infile);
+    if (infile != NULL)
+        jpeg_stdio_src(&cinfo, infile);
+    else
+        jpeg_mem_src(&cinfo, buffer, (unsigned long)size);
     jpeg_read_header(&cinfo, TRUE);
 
     /* Set parameters for decompression */
@@ -39,57 +63,348 @@ Image* read_jpeg(const char *filename) {
     jpeg_start_decompress(&cinfo);
 
     /* Allocate memory for the image data structure and pixel buffer */
-    img = (Image*)malloc(sizeof(Image));
+    img = (Image*)calloc(1, sizeof(Image));
     if (img == NULL) {
         fprintf(stderr, "Memory error for Image struct!\n");
-        jpeg_finish_decompress(&cinfo);
-        fclose(infile);
+        jpeg_destroy_decompress(&cinfo);
         return NULL;
     }
 
     img->width = cinfo.output_width;
     img->height = cinfo.output_height;
     img->channels = cinfo.output_components;
-    long raw_image_size = img->width * img->height * img->channels;
+    size_t raw_image_size = (size_t)img->width * img->height * img->channels;
     img->data = (unsigned char*)malloc(raw_image_size);
 
     if (img->data == NULL) {
         fprintf(stderr, "Memory error for image data!\n");
-        free(img);
-        jpeg_finish_decompress(&cinfo);
-        fclose(infile);
+        jpeg_destroy_decompress(&cinfo);
+        free_image(img);
         return NULL;
     }
 
     /* Read scanlines */
-    // Explicação 1 
+    // Explicação 1
     while (cinfo.output_scanline < cinfo.output_height) {
         // Aloca o ponteiro do buffer para a localização da memória do struct
         // Dai ele vai ler a próxima linha da imagem e já vai direto para a struct
-        row_pointer[0] = &(img->data[cinfo.output_scanline * img->width * img->channels]); // &(struct->data) == mudando o ponteiro para a struct
+        row_pointer[0] = &(img->data[(size_t)cinfo.output_scanline * img->width * img->channels]); // &(struct->data) == mudando o ponteiro para a struct
         jpeg_read_scanlines(&cinfo, row_pointer, 1);
     }
 
     jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    return img;
+}
+
+/* Function to read a JPEG file and return an Image struct */
+Image* read_jpeg(const char *filename) {
+    FILE *infile;
+    Image *img;
+
+    if ((infile = fopen(filename, "rb")) == NULL) {
+        fprintf(stderr, "Can't open %s\n", filename);
+        return NULL;
+    }
+
+    img = decode_jpeg(infile, NULL, 0);
     fclose(infile);
+    return img;
+}
+
+/* Decodes an in-memory JPEG, the buffer is only read */
+Image* read_jpeg_mem(const unsigned char *data, size_t size) {
+    return decode_jpeg(NULL, data, size);
+}
+
+/* Same as read_jpeg, but libjpeg reads straight from a mapping of the file */
+Image* read_jpeg_mapped(const char *filename) {
+    MappedFile file;
+    Image *img;
+
+    if (map_file(filename, &file) != 0)
+        return NULL;
+
+    img = read_jpeg_mem(file.data, file.size);
+    if (file.truncated && img != NULL) {
+        fprintf(stderr, "%s was truncated while it was being read\n", filename);
+        free_image(img);
+        img = NULL;
+    }
+    unmap_file(&file);
+    return img;
+}
+
+/* W[half][u]: C(u) * mean of cos((2x + 1) u pi / 16) over x in one half of
+ * the block. Even u > 0 averages out to zero over a half. */
+static void quadrant_weights(double weights[2][DCTSIZE]) {
+    for (int half = 0; half < 2; half++) {
+        for (int u = 0; u < DCTSIZE; u++) {
+            double sum = 0.0;
+            for (int x = half * 4; x < half * 4 + 4; x++)
+                sum += cos((2 * x + 1) * u * M_PI / 16.0);
+            weights[half][u] = (u == 0 ? M_SQRT1_2 : 1.0) * sum / 4.0;
+        }
+    }
+}
+
+static unsigned char clamp_sample(double value) {
+    value = floor(value + 0.5);
+    return value < 0 ? 0 : value > MAXJSAMPLE ? MAXJSAMPLE : (unsigned char)value;
+}
+
+/* The samples_per_block rule from jpegReader.h. Outside read_jpeg_dct_luma so
+ * nothing there is reassigned after its setjmp (-Wclobbered). */
+static int luma_samples_per_block(int requested, const jpeg_component_info *luma) {
+    if (requested <= 0)
+        return (luma->width_in_blocks < 64 || luma->height_in_blocks < 64) ? 2 : 1;
+    return requested > 2 ? 2 : requested;
+}
+
+Image* read_jpeg_dct_luma(const unsigned char *data, size_t size, int samples_per_block) {
+    struct jpeg_decompress_struct cinfo;
+    JpegErrorManager jerr;
+    Image * volatile img = NULL; /* volatile: must survive the longjmp */
+    double weights[2][DCTSIZE];
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpeg_error_exit;
+    if (setjmp(jerr.setjmp_buffer)) {
+        jpeg_destroy_decompress(&cinfo);
+        free_image(img);
+        return NULL;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, data, (unsigned long)size);
+    jpeg_read_header(&cinfo, TRUE);
+
+    /* Só o componente 0 interessa, e ele só é luma em JPEGs YCbCr ou cinza */
+    if (cinfo.jpeg_color_space != JCS_YCbCr && cinfo.jpeg_color_space != JCS_GRAYSCALE) {
+        jpeg_destroy_decompress(&cinfo);
+        return NULL;
+    }
+
+    /* Entropy decoding only: no dequantization, no IDCT, no upsampling */
+    jvirt_barray_ptr *coef_arrays = jpeg_read_coefficients(&cinfo);
+    jpeg_component_info *luma = &cinfo.comp_info[0];
+    JQUANT_TBL *quant = luma->quant_table;
+    if (quant == NULL)
+        ERREXIT(&cinfo, JERR_NO_QUANT_TABLE);
+
+    const int samples = luma_samples_per_block(samples_per_block, luma);
+    quadrant_weights(weights);
+
+    img = (Image*)calloc(1, sizeof(Image));
+    if (img == NULL)
+        ERREXIT1(&cinfo, JERR_OUT_OF_MEMORY, 0);
+
+    /* Padding blocks past the real image edge are left out */
+    img->width = (int)((luma->downsampled_width * samples + DCTSIZE - 1) / DCTSIZE);
+    img->height = (int)((luma->downsampled_height * samples + DCTSIZE - 1) / DCTSIZE);
+    img->channels = 1;
+    img->data = (unsigned char*)malloc((size_t)img->width * img->height);
+    if (img->data == NULL)
+        ERREXIT1(&cinfo, JERR_OUT_OF_MEMORY, 1);
+
+    for (int y = 0; y < img->height; y += samples) {
+        JDIMENSION block_row = y / samples;
+        JBLOCKARRAY rows = (*cinfo.mem->access_virt_barray)((j_common_ptr)&cinfo, coef_arrays[0], block_row, 1, FALSE);
+
+        for (int x = 0; x < img->width; x += samples) {
+            JCOEF *block = rows[0][x / samples];
+
+            if (samples == 1) {
+                /* DC = 8 * block mean (level shifted) */
+                img->data[(size_t)y * img->width + x] = clamp_sample(block[0] * quant->quantval[0] / 8.0 + CENTERJSAMPLE);
+                continue;
+            }
+
+            /* Mean of each 4x4 quadrant straight from the coefficients.
+             * Coefficients are in natural order: block[row * 8 + col] = F(v = row, u = col) */
+            for (int qy = 0; qy < 2 && y + qy < img->height; qy++) {
+                for (int qx = 0; qx < 2 && x + qx < img->width; qx++) {
+                    double mean = 0.0;
+                    for (int v = 0; v < DCTSIZE; v++) {
+                        if (v > 1 && v % 2 == 0)
+                            continue; /* even frequencies average out over half a block */
+                        for (int u = 0; u < DCTSIZE; u++) {
+                            if (u > 1 && u % 2 == 0)
+                                continue;
+                            int k = v * DCTSIZE + u;
+                            if (block[k] != 0)
+                                mean += weights[qy][v] * weights[qx][u] * block[k] * quant->quantval[k];
+                        }
+                    }
+                    img->data[(size_t)(y + qy) * img->width + x + qx] = clamp_sample(mean / 4.0 + CENTERJSAMPLE);
+                }
+            }
+        }
+    }
+
+    jpeg_finish_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
+    return img;
+}
+
+Image* read_jpeg_dct_luma_mapped(const char *filename, int samples_per_block) {
+    MappedFile file;
+    Image *img;
 
+    if (map_file(filename, &file) != 0)
+        return NULL;
+
+    img = read_jpeg_dct_luma(file.data, file.size, samples_per_block);
+    if (file.truncated && img != NULL) {
+        fprintf(stderr, "%s was truncated while it was being read\n", filename);
+        free_image(img);
+        img = NULL;
+    }
+    unmap_file(&file);
     return img;
 }
 
+/* EXIF / TIFF integers, in the byte order the TIFF header declares */
+static unsigned read_u16(const unsigned char *p, int little) {
+    return little ? (unsigned)(p[0] | (p[1] << 8)) : (unsigned)((p[0] << 8) | p[1]);
+}
+
+static unsigned long read_u32(const unsigned char *p, int little) {
+    return little ? ((unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24))
+                  : (((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) | ((unsigned long)p[2] << 8) | (unsigned long)p[3]);
+}
+
+/* Value of a 12 byte IFD entry holding a single SHORT (type 3) or LONG */
+static unsigned long ifd_entry_value(const unsigned char *entry, int little) {
+    return read_u16(entry + 2, little) == 3 ? read_u16(entry + 8, little) : read_u32(entry + 8, little);
+}
+
+/* Returns the entry count of the IFD at offset, 0 when it doesn't fit in the
+ * TIFF block (next IFD link included) */
+static unsigned ifd_entries(const unsigned char *tiff, size_t size, unsigned long offset, int little) {
+    unsigned count;
+    if (offset < 8 || offset + 2 > size)
+        return 0;
+    count = read_u16(tiff + offset, little);
+    if (offset + 2 + (size_t)count * 12 + 4 > size)
+        return 0;
+    return count;
+}
+
+/* TIFF block of an APP1 Exif segment: orientation from IFD0, the JPEG
+ * thumbnail (JPEGInterchangeFormat / Length) from IFD1 */
+static void parse_exif(const unsigned char *tiff, size_t size, JpegExifInfo *info) {
+    int little;
+    unsigned count, i;
+    unsigned long ifd0, ifd1, offset = 0, length = 0;
+
+    if (size < 8)
+        return;
+    if (tiff[0] == 'I' && tiff[1] == 'I')
+        little = 1;
+    else if (tiff[0] == 'M' && tiff[1] == 'M')
+        little = 0;
+    else
+        return;
+    if (read_u16(tiff + 2, little) != 42)
+        return;
+
+    ifd0 = read_u32(tiff + 4, little);
+    count = ifd_entries(tiff, size, ifd0, little);
+    if (count == 0)
+        return;
+    for (i = 0; i < count; i++) {
+        const unsigned char *entry = tiff + ifd0 + 2 + i * 12;
+        if (read_u16(entry, little) == 0x0112) {
+            unsigned long orientation = ifd_entry_value(entry, little);
+            if (orientation >= 1 && orientation <= 8)
+                info->orientation = (int)orientation;
+        }
+    }
+
+    ifd1 = read_u32(tiff + ifd0 + 2 + count * 12, little);
+    count = ifd_entries(tiff, size, ifd1, little);
+    for (i = 0; i < count; i++) {
+        const unsigned char *entry = tiff + ifd1 + 2 + i * 12;
+        unsigned tag = read_u16(entry, little);
+        if (tag == 0x0201)
+            offset = ifd_entry_value(entry, little);
+        else if (tag == 0x0202)
+            length = ifd_entry_value(entry, little);
+    }
+
+    // Offsets are relative to the TIFF header
+    if (offset >= 8 && length > 0 && offset + length <= size) {
+        info->thumbnail = tiff + offset;
+        info->thumbnail_size = length;
+    }
+}
+
+int read_jpeg_exif(const unsigned char *data, size_t size, JpegExifInfo *info) {
+    size_t pos = 2;
+
+    memset(info, 0, sizeof(*info));
+    info->orientation = 1;
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return -1;
+
+    /* Walks the marker segments up to the start of the scan, nothing past
+     * the header is touched */
+    while (pos + 4 <= size) {
+        unsigned char marker = data[pos + 1];
+        size_t length, payload;
+        const unsigned char *segment;
+
+        if (data[pos] != 0xFF)
+            break;
+        if (marker == 0xFF) { /* fill byte */
+            pos++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) { /* no payload */
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xDA || marker == 0xD9) /* SOS / EOI */
+            break;
+
+        length = read_u16(data + pos + 2, 0);
+        if (length < 2 || pos + 2 + length > size)
+            break;
+        /* The length field counts itself */
+        segment = data + pos + 4;
+        payload = length - 2;
+
+        if (marker == 0xE1 && info->thumbnail == NULL && payload > 6 && memcmp(segment, "Exif\0\0", 6) == 0) {
+            parse_exif(segment + 6, payload - 6, info);
+        } else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC && payload >= 5) {
+            /* SOFn: precision, height, width */
+            info->height = (int)read_u16(segment + 1, 0);
+            info->width = (int)read_u16(segment + 3, 0);
+        }
+        pos += 2 + length;
+    }
+
+    return info->width > 0 && info->height > 0 ? 0 : -1;
+}
+
+#ifdef JPEG_MAIN
 /* Main function to demonstrate usage */
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <jpeg_file>\n", argv[0]);
+    int mapped = argc == 3 && strcmp(argv[1], "--mmap") == 0;
+    if (argc != 2 && !mapped) {
+        fprintf(stderr, "Usage: %s [--mmap] <jpeg_file>\n", argv[0]);
         return EXIT_FAILURE;
     }
 
-    Image *image = read_jpeg(argv[1]);
+    const char *filename = argv[argc - 1];
+    Image *image = mapped ? read_jpeg_mapped(filename) : read_jpeg(filename);
 
-    // gcc jpeg.c -ljpeg -o outer && ./outer land.jpg
+    // gcc -DJPEG_MAIN jpeg.c mappedFile.c -ljpeg -o outer && ./outer land.jpg
 
     if (image != NULL) {
-        printf("Successfully read image: %s\n", argv[1]);
+        printf("Successfully read image: %s\n", filename);
         printf("Dimensions: %d x %d pixels\n", image->width, image->height);
         printf("Channels: %d\n", image->channels);
 
@@ -97,17 +412,19 @@ int main(int argc, char *argv[]) {
         // Explicação 2
         int x = 1080, y = 1080;
 
-        // Faz um slice do array, começando pelo pixel que se quer ler 
+        // Faz um slice do array, começando pelo pixel que se quer ler
         // eg: data[pixel_loc:] em python (que desgraçado)
-        unsigned char *pixel = &(image->data[(y * image->width + x) * image->channels]);
-        printf("Pixel at (%d, %d): R=%u, G=%u, B=%u\n", x, y, pixel[0], pixel[1], pixel[2]);
+        if (x < image->width && y < image->height) {
+            unsigned char *pixel = &(image->data[((size_t)y * image->width + x) * image->channels]);
+            printf("Pixel at (%d, %d): R=%u, G=%u, B=%u\n", x, y, pixel[0], pixel[1], pixel[2]);
+        }
 
         /* Free the allocated memory */
-        free(image->data);
-        free(image);
+        free_image(image);
     } else {
         return EXIT_FAILURE;
     }
 
     return EXIT_SUCCESS;
 }
+#endif
@@ -0,0 +1,42 @@
+#ifndef JPEG_READER_H
+#define JPEG_READER_H
+
+#include <stddef.h>
+
+#include "image.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* All of them return NULL (after printing why) on unreadable, truncated or
+ * corrupt input instead of letting libjpeg exit() the process */
+Image* read_jpeg(const char *filename);
+Image* read_jpeg_mem(const unsigned char *data, size_t size);
+Image* read_jpeg_mapped(const char *filename);
+
+/* Grayscale image rebuilt from the quantized luma DCT coefficients
+ * (jpeg_read_coefficients), without running an inverse DCT: either 1 pixel
+ * per 8x8 block from the DC term, or 2x2 pixels per block holding the exact
+ * mean of each 4x4 quadrant. samples_per_block = 0 picks 2 for images under
+ * 64 blocks on a side, 1 otherwise. NULL for non-YCbCr/grayscale JPEGs too. */
+Image* read_jpeg_dct_luma(const unsigned char *data, size_t size, int samples_per_block);
+Image* read_jpeg_dct_luma_mapped(const char *filename, int samples_per_block);
+
+/* What the header of a JPEG says about it, without decoding anything */
+typedef struct {
+    int width, height;              /* main image, from the SOF segment */
+    int orientation;                /* EXIF orientation 1..8, 1 when absent */
+    const unsigned char *thumbnail; /* EXIF (IFD1) JPEG thumbnail inside data, or NULL */
+    size_t thumbnail_size;
+} JpegExifInfo;
+
+/* Reads the marker segments up to the first scan. Returns 0 when a frame
+ * header was found, -1 for non-JPEG or truncated headers. */
+int read_jpeg_exif(const unsigned char *data, size_t size, JpegExifInfo *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JPEG_READER_H */
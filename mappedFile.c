@@ -0,0 +1,110 @@
+/* madvise(), MADV_*, MAP_ANONYMOUS and siginfo_t are not declared under a strict -std=c99 */
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mappedFile.h"
+
+/* SIGBUS is delivered to the thread that touched the page, so each thread
+ * only has to look through the files it mapped itself */
+static __thread MappedFile *volatile live_mappings;
+static struct sigaction previous_sigbus;
+static pthread_once_t sigbus_once = PTHREAD_ONCE_INIT;
+
+static void on_sigbus(int sig, siginfo_t *info, void *context) {
+    const unsigned char *address = (const unsigned char *)info->si_addr;
+    MappedFile *file;
+
+    (void)context;
+    for (file = live_mappings; file != NULL; file = file->next) {
+        if (address < file->data || address >= file->data + file->size)
+            continue;
+        /* Mesmo endereço e tamanho: o leitor volta e lê zeros, e o munmap
+         * do unmap_file continua valendo para a memória anônima */
+        if (mmap((void *)file->data, file->size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+            break;
+        file->truncated = 1;
+        return;
+    }
+
+    /* Not one of ours: the read faults again and goes wherever SIGBUS went
+     * before. A SIGBUS sent by kill() has no read to retry, send it again. */
+    sigaction(SIGBUS, &previous_sigbus, NULL);
+    if (info->si_code <= 0)
+        raise(sig);
+}
+
+static void install_sigbus_handler(void) {
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = on_sigbus;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGBUS, &action, &previous_sigbus);
+}
+
+int map_file(const char *path, MappedFile *file) {
+    struct stat st;
+    void *data;
+    int fd;
+
+    file->data = NULL;
+    file->size = 0;
+    file->truncated = 0;
+    file->next = NULL;
+
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        fprintf(stderr, "Can't map %s: not a regular non-empty file\n", path);
+        close(fd);
+        return -1;
+    }
+
+    /* O mapeamento continua válido depois do close */
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Can't map %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    /* The decoders walk the file front to back exactly once */
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    madvise(data, (size_t)st.st_size, MADV_WILLNEED);
+
+    pthread_once(&sigbus_once, install_sigbus_handler);
+    file->data = (const unsigned char *)data;
+    file->size = (size_t)st.st_size;
+    file->next = live_mappings;
+    live_mappings = file;
+    return 0;
+}
+
+void unmap_file(MappedFile *file) {
+    MappedFile *volatile *link;
+
+    if (file->data != NULL) {
+        for (link = &live_mappings; *link != NULL; link = &(*link)->next) {
+            if (*link == file) {
+                *link = file->next;
+                break;
+            }
+        }
+        munmap((void *)file->data, file->size);
+    }
+    file->data = NULL;
+    file->size = 0;
+}
@@ -0,0 +1,37 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <signal.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Read-only mapping of a whole file, so the decoders can read the encoded
+ * bytes straight from the page cache instead of copying them through stdio.
+ *
+ * A file truncated while it is mapped would kill the process with SIGBUS on
+ * the first read past its new end. While mapped, the file is registered with
+ * the thread that mapped it: a SIGBUS inside it swaps the whole mapping for
+ * zero pages and sets `truncated`, so the decoder just sees a broken image.
+ * Check `truncated` after reading and drop whatever came out of the bytes.
+ * The struct must stay where it is (no copies) until unmap_file. */
+typedef struct MappedFile {
+    const unsigned char *data;
+    size_t size;
+    volatile sig_atomic_t truncated;
+    struct MappedFile *next; /* mapeamentos vivos da thread */
+} MappedFile;
+
+/* Returns 0 on success, -1 (with a message on stderr) when the file can't be
+ * opened, is empty or can't be mapped. The mapping is advised sequential.
+ * Both calls must come from the same thread. */
+int map_file(const char *path, MappedFile *file);
+void unmap_file(MappedFile *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAPPEDFILE_H */
@@ -1,30 +1,64 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <png.h>
 
+#include "pngReader.h"
+#include "mappedFile.h"
+
 // http://www.libpng.org/pub/png/book/chapter13.html
 // https://gist.github.com/abforce/2a4dbdeb47d4e6bcaf79de38380a13b9
 // https://stackoverflow.com/questions/65589714/read-and-write-a-png-file-using-libpng-in-c
 
-void read_png_file(const char* filename) {
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) {
-        printf("Error: Could not open file %s\n", filename);
-        return;
-    }
+/* Source for png_set_read_fn: hands libpng the bytes of an in-memory file */
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    size_t offset;
+} PngMemoryReader;
+
+static void png_read_memory(png_structp png, png_bytep out, png_size_t length) {
+    PngMemoryReader *reader = (PngMemoryReader*)png_get_io_ptr(png);
+    if (length > reader->size - reader->offset)
+        png_error(png, "Truncated PNG data"); // longjmp de volta para decode_png
+    memcpy(out, reader->data + reader->offset, length);
+    reader->offset += length;
+}
 
+/* Decodes from a stdio stream when fp is set, otherwise from reader */
+static Image* decode_png(FILE *fp, PngMemoryReader *reader) {
     // 1. Create and initialize the png_structs
     png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!png) abort();
+    if (!png) {
+        fprintf(stderr, "Error: png_create_read_struct failed\n");
+        return NULL;
+    }
 
     png_infop info = png_create_info_struct(png);
-    if (!info) abort();
+    if (!info) {
+        fprintf(stderr, "Error: png_create_info_struct failed\n");
+        png_destroy_read_struct(&png, NULL, NULL);
+        return NULL;
+    }
+
+    /* volatile: must survive the longjmp */
+    Image * volatile img = NULL;
+    png_bytep * volatile row_pointers = NULL;
 
     // 2. Set up error handling
-    if (setjmp(png_jmpbuf(png))) abort(); // Required for libpng error handling
+    // libpng already printed the reason, just clean up and give up on this file
+    if (setjmp(png_jmpbuf(png))) {
+        free(row_pointers);
+        free_image(img);
+        png_destroy_read_struct(&png, &info, NULL);
+        return NULL;
+    }
 
     // 3. Initialize IO
-    png_init_io(png, fp);
+    if (fp != NULL)
+        png_init_io(png, fp);
+    else
+        png_set_read_fn(png, reader, png_read_memory);
 
     // 4. Read file information
     png_read_info(png, info);
@@ -47,7 +81,7 @@ void read_png_file(const char* filename) {
 
     if (png_get_valid(png, info, PNG_INFO_tRNS))
         png_set_tRNS_to_alpha(png);
-    
+
     if (color_type == PNG_COLOR_TYPE_RGB || color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_PALETTE)
         png_set_filler(png, 0xFF, PNG_FILLER_AFTER);
 
@@ -56,37 +90,89 @@ void read_png_file(const char* filename) {
 
     png_read_update_info(png, info); // Update info based on transforms
 
-    // 6. Allocate memory for image data (row pointers)
-    png_bytep *row_pointers = (png_bytep*)malloc(sizeof(png_bytep) * height);
-    for (int y = 0; y < height; y++) {
-        row_pointers[y] = (png_byte*)malloc(png_get_rowbytes(png, info));
+    // 6. Allocate memory for image data, row pointers point inside one buffer
+    size_t rowbytes = png_get_rowbytes(png, info);
+    img = (Image*)calloc(1, sizeof(Image));
+    row_pointers = (png_bytep*)malloc(sizeof(png_bytep) * height);
+    if (img == NULL || row_pointers == NULL || (img->data = (unsigned char*)malloc(rowbytes * height)) == NULL)
+        png_error(png, "Out of memory");
+
+    img->width = (int)width;
+    img->height = (int)height;
+    img->channels = png_get_channels(png, info);
+    for (png_uint_32 y = 0; y < height; y++) {
+        row_pointers[y] = img->data + y * rowbytes;
     }
 
     // 7. Read the image data
     png_read_image(png, row_pointers);
 
-    // y (height)
-    png_byte* row = row_pointers[300]; 
-    // x (width)
-    png_byte* ptr = &(row[400 * 4]); // Assuming 4 channels (RGBA) after transforms
-    printf("Pixel at [0, 0] has RGBA values: %d - %d - %d - %d\n", ptr[0], ptr[1], ptr[2], ptr[3]);
+    // 8. Clean up
+    free(row_pointers);
+    png_destroy_read_struct(&png, &info, NULL);
+    return img;
+}
+
+Image* read_png_file(const char* filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file %s\n", filename);
+        return NULL;
+    }
 
-    // 9. Clean up
+    Image *img = decode_png(fp, NULL);
     fclose(fp);
-    for (int y = 0; y < height; y++) {
-        free(row_pointers[y]);
+    return img;
+}
+
+/* Decodes an in-memory PNG, the buffer is only read */
+Image* read_png_mem(const unsigned char *data, size_t size) {
+    PngMemoryReader reader = {data, size, 0};
+    return decode_png(NULL, &reader);
+}
+
+/* Same as read_png_file, but libpng pulls its bytes from a mapping of the file */
+Image* read_png_mapped(const char *filename) {
+    MappedFile file;
+    Image *img;
+
+    if (map_file(filename, &file) != 0)
+        return NULL;
+
+    img = read_png_mem(file.data, file.size);
+    if (file.truncated && img != NULL) {
+        fprintf(stderr, "%s was truncated while it was being read\n", filename);
+        free_image(img);
+        img = NULL;
     }
-    free(row_pointers);
-    png_destroy_read_struct(&png, &info, NULL);
+    unmap_file(&file);
+    return img;
 }
 
+#ifdef PNG_MAIN
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <jpeg_file>\n", argv[0]);
+    int mapped = argc == 3 && strcmp(argv[1], "--mmap") == 0;
+    if (argc != 2 && !mapped) {
+        fprintf(stderr, "Usage: %s [--mmap] <png_file>\n", argv[0]);
         return EXIT_FAILURE;
     }
-    // Compile with: gcc -std=c99 main.c -lpng
-    // gcc png.c -lpng -o outer && ./outer dado.png 
-    read_png_file(argv[1]);
+    // Compile with: gcc -std=c99 -DPNG_MAIN png.c mappedFile.c -lpng
+    // gcc -DPNG_MAIN png.c mappedFile.c -lpng -o outer && ./outer dado.png
+    const char *filename = argv[argc - 1];
+    Image *image = mapped ? read_png_mapped(filename) : read_png_file(filename);
+    if (image == NULL)
+        return EXIT_FAILURE;
+
+    printf("Dimensions: %d x %d pixels, %d channels\n", image->width, image->height, image->channels);
+
+    // y (height), x (width)
+    int x = 400, y = 300;
+    if (x < image->width && y < image->height) {
+        png_byte* ptr = &(image->data[((size_t)y * image->width + x) * image->channels]); // 4 channels (RGBA) after transforms
+        printf("Pixel at [%d, %d] has RGBA values: %d - %d - %d - %d\n", y, x, ptr[0], ptr[1], ptr[2], ptr[3]);
+    }
+
+    free_image(image);
     return 0;
 }
+#endif
@@ -0,0 +1,22 @@
+#ifndef PNG_READER_H
+#define PNG_READER_H
+
+#include <stddef.h>
+
+#include "image.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Any PNG is expanded to 8-bit RGBA. NULL (after printing why) on
+ * unreadable, truncated or corrupt input, the process is never aborted */
+Image* read_png_file(const char *filename);
+Image* read_png_mem(const unsigned char *data, size_t size);
+Image* read_png_mapped(const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PNG_READER_H */
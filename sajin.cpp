@@ -1,87 +1,350 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgcodecs.hpp>
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <functional>
 #include <iostream>
-#include <stdexcept> 
+#include <stdexcept>
 #include <vector>
 
+#include "agendador.hpp"
+#include "archiveReader.hpp"
+#include "dedupTable.hpp"
+#include "imageHash.hpp"
 #include "vectorOps.hpp"
+#include "watchMode.hpp"
 
-std::string averageHash(const cv::Mat& image, int hashSize=8, std::function<double(Vector2D)> meanFunc=meanVector2D) {
-    if(hashSize < 2) 
-        throw std::invalid_argument("The hash size must be >= 2");
+struct SaidaHash {
+    std::string hashType;
+    int hashSize;
+    bool mapped;
+    bool exifThumbnail;
+    bool timings;
+    std::ostream* out;
+    DedupTable* dedup = nullptr;
+    std::mutex mutex;
+    std::atomic<int> failures{0};
 
-    cv::Mat grayscale; 
-    cv::cvtColor(image, grayscale, cv::COLOR_RGB2GRAY);
+    // Membros de arquivos tar/zip lidos e ainda não hasheados: o leitor
+    // espera aqui para não carregar o arquivo inteiro na memória
+    std::mutex mutexEmVoo;
+    std::condition_variable cvEmVoo;
+    size_t emVoo = 0;
 
-    cv::Mat resizeImage; 
-    cv::resize(grayscale, resizeImage, cv::Size(hashSize, hashSize), 0.0, 0.0, cv::INTER_LANCZOS4);
+    void reservar(size_t limite) {
+        std::unique_lock<std::mutex> trava(mutexEmVoo);
+        cvEmVoo.wait(trava, [&] { return emVoo < limite; });
+        emVoo++;
+    }
 
-    int height = grayscale.rows;
-    int width = grayscale.cols;
-    int channels = grayscale.channels();
-    std::cout << "Height: " << height << ", Width: " << width << ", Channels: " << channels << std::endl;
+    void liberar() {
+        {
+            std::lock_guard<std::mutex> trava(mutexEmVoo);
+            emVoo--;
+        }
+        cvEmVoo.notify_one();
+    }
+};
 
-    std::cout << "Height: " << resizeImage.rows << ", Width: " << resizeImage.cols << ", Channels: " << resizeImage.channels() << std::endl;
+// Uma imagem por tarefa, lida do disco ou já na memória (membro de um
+// arquivo tar/zip); a linha sai assim que o hash fica pronto, então com
+// mais de um trabalhador a ordem da saída não é a da entrada
+class TarefaHash : public Tarefa {
+private:
+    std::string caminho;
+    std::vector<unsigned char> dados;
+    bool emMemoria;
+    SaidaHash& saida;
 
+public:
+    TarefaHash(std::string caminho, SaidaHash& saida)
+        : Tarefa("hash"), caminho(std::move(caminho)), emMemoria(false), saida(saida) {}
 
-    cv::imshow("Pringles", resizeImage);
-    int a = cv::waitKey(20);
+    TarefaHash(std::string caminho, std::vector<unsigned char> dados, SaidaHash& saida)
+        : Tarefa("hash"), caminho(std::move(caminho)), dados(std::move(dados)), emMemoria(true), saida(saida) {}
 
-    Vector2D pixels = matGSToVector2D(resizeImage);
-    for (size_t i = 0; i < hashSize; i++) {
-        std::cout << "[";  
-        for (size_t j = 0; j < hashSize; j++) {
-            std::cout << (int)(pixels[i][j]) << ","; 
+    void executar() override {
+        auto start = std::chrono::steady_clock::now();
+        std::string hash;
+        try {
+            if (emMemoria && saida.dedup != nullptr)
+                hash = saida.dedup->hashData(dados.data(), dados.size(), caminho);
+            else if (emMemoria)
+                hash = hashImageData(dados.data(), dados.size(), caminho, saida.hashType, saida.hashSize, saida.exifThumbnail);
+            else if (saida.dedup != nullptr)
+                hash = saida.dedup->hashFile(caminho);
+            else
+                hash = hashImageFile(caminho, saida.hashType, saida.hashSize, saida.mapped, saida.exifThumbnail);
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> trava(saida.mutex);
+            std::cerr << "ERROR: " << caminho << ": " << e.what() << std::endl;
         }
-        std::cout << "]" << std::endl;  
-    }
-    
-    double meanFuncReturn = meanFunc(pixels); // Average of pixels in the resized image
-
-    std::vector<std::vector<bool>> diff (hashSize, std::vector<bool>(hashSize)); 
-    std::cout << "[";  
-    // diff = pixels > avg
-    for (size_t i = 0; i < hashSize; i++) {
-        std::cout << "[";  
-        for (size_t j = 0; j < hashSize; j++) {
-            diff[i][j] = pixels[i][j] > meanFuncReturn;
-            std::cout << diff[i][j] << ","; 
+        if (emMemoria) {
+            std::vector<unsigned char>().swap(dados);
+            saida.liberar();
         }
-        std::cout << "]" << std::endl;  
+        if (hash.empty()) {
+            saida.failures++;
+            return;
+        }
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> trava(saida.mutex);
+        *saida.out << hash << "\t" << caminho;
+        if (saida.timings)
+            *saida.out << "\t" << micros;
+        *saida.out << "\n";
+        concluida = true;
     }
-    std::cout << "]";  
+};
 
-    std::string hex = vector1DToHex(flattenVector2D(diff));
-    std::cout << hex << endl; 
-    return "Suck it, nerd";
+// Prints one "<hash>\t<path>" line per image, the same layout readHashFile()
+// accepts. --timings appends the read + decode + hash time in microseconds,
+// --mmap decodes from a mapping of each file instead of cv::imread.
+// phash-dct reads JPEGs through their DCT coefficients (see perceptualHashJpeg),
+// --exif-thumb hashes the EXIF thumbnail of camera JPEGs when it is usable.
+// .tar and .zip inputs are read member by member, without extracting them,
+// and their images reported as "archive!member".
+// --threads hashes on N workers (0 = one per core) and prints the lines in
+// completion order; the default of 1 keeps the input order.
+// --dedup looks every input up by a content hash of its bytes first and
+// reuses the hash of an identical file seen before, --dedup-store keeps
+// that table in a file across runs; with --mmap they map the inputs too.
+// --watch keeps running and hashes the images written into a directory tree
+// until SIGINT/SIGTERM, then prints the same --dedup/--exif-thumb stats,
+// --out appends the lines to a hash file instead of stdout, flushed per line.
+static void usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--hash ahash|phash|phash-dct] [--size N] [--timings] [--mmap] [--exif-thumb] [--threads N] [--dedup] [--dedup-store table.txt] [--out hashes.txt] [--list paths.txt] <images, .tar or .zip...>" << std::endl;
+    std::cerr << "       " << program << " --watch <dir> [--debounce ms] [--hash ...] [--size N] [--timings] [--mmap] [--exif-thumb] [--dedup] [--dedup-store table.txt] [--out hashes.txt]" << std::endl;
 }
 
-
 int main(int argc, char* argv[]){
-    // cv::Mat imagem;
-    // imagem = cv::imread(argv[1], cv::IMREAD_GRAYSCALE);
-    // cv::namedWindow("Minha Imagem", cv::WINDOW_NORMAL);
-    // cv::resizeWindow("Minha Imagem", 600,600);
-    // imshow("Minha Imagem", imagem);
-    // cv::waitKey(0);
+    std::string hashType = "ahash";
+    int hashSize = 8;
+    bool timings = false;
+    bool mapped = false;
+    bool exifThumbnail = false;
+    int threads = 1;
+    bool dedup = false;
+    std::string dedupStore;
+    std::string watchRoot;
+    int debounceMs = WatchOptions().debounceMs;
+    std::string outPath;
+    std::vector<std::string> paths;
 
-    // imagem = cv::imread(argv[1], cv::IMREAD_COLOR);
-    // cv::namedWindow("Minha Imagem", cv::WINDOW_NORMAL);
-    // cv::resizeWindow("Minha Imagem", 600,600);
-    // imshow("Minha Imagem", imagem);
-    // cv::waitKey(0); 
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--hash" && hasValue) {
+                hashType = argv[++i];
+            } else if (arg == "--size" && hasValue) {
+                hashSize = std::stoi(argv[++i]);
+            } else if (arg == "--timings") {
+                timings = true;
+            } else if (arg == "--mmap") {
+                mapped = true;
+            } else if (arg == "--exif-thumb") {
+                exifThumbnail = true;
+            } else if (arg == "--threads" && hasValue) {
+                threads = std::stoi(argv[++i]);
+            } else if (arg == "--dedup") {
+                dedup = true;
+            } else if (arg == "--dedup-store" && hasValue) {
+                dedupStore = argv[++i];
+                dedup = true;
+            } else if (arg == "--watch" && hasValue) {
+                watchRoot = argv[++i];
+            } else if (arg == "--debounce" && hasValue) {
+                debounceMs = std::stoi(argv[++i]);
+            } else if (arg == "--out" && hasValue) {
+                outPath = argv[++i];
+            } else if (arg == "--list" && hasValue) {
+                std::ifstream list(argv[++i]);
+                std::string line;
+                while (std::getline(list, line))
+                    if (!line.empty())
+                        paths.push_back(line);
+            } else if (arg.rfind("--", 0) == 0) {
+                usage(argv[0]);
+                return 1;
+            } else {
+                paths.push_back(arg);
+            }
+        }
+    } catch (const std::logic_error&) {
+        // --size, --threads e --debounce com valor não numérico (stoi)
+        usage(argv[0]);
+        return 1;
+    }
 
-    // cv::Mat image = readImageMat(argv[1]);
-    // Vector3D imagemVector = matToVector3D(image);
+    if ((paths.empty() == watchRoot.empty()) || !isKnownHashType(hashType) || threads < 0) {
+        usage(argv[0]);
+        return 1;
+    }
 
-    cv::Mat image = readImageMat("data/0a.jpg");
-    averageHash(image);
+    std::ofstream outFile;
+    if (!outPath.empty()) {
+        outFile.open(outPath, std::ios::app);
+        if (!outFile) {
+            std::cerr << "ERROR: Can't open " << outPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = outPath.empty() ? std::cout : outFile;
 
+    int failures = 0;
+    std::unique_ptr<DedupTable> dedupTable;
+    if (dedup) {
+        dedupTable.reset(new DedupTable(hashType, hashSize, exifThumbnail, mapped));
+        if (!dedupStore.empty()) {
+            try {
+                dedupTable->openStore(dedupStore);
+            } catch (const std::exception& e) {
+                std::cerr << "ERROR: " << e.what() << std::endl;
+                return 1;
+            }
+        }
+    }
 
-    return 0;
-}
+    if (!watchRoot.empty()) {
+        WatchOptions options;
+        options.hashType = hashType;
+        options.hashSize = hashSize;
+        options.mapped = mapped;
+        options.exifThumbnail = exifThumbnail;
+        options.debounceMs = debounceMs;
+        options.dedup = dedupTable.get();
+        try {
+            watchDirectory(watchRoot, options, [&](const std::string& path, const std::string& hash, long long micros) {
+                out << hash << "\t" << path;
+                if (timings)
+                    out << "\t" << micros;
+                out << std::endl;
+            });
+        } catch (const std::exception& e) {
+            std::cerr << "ERROR: " << e.what() << std::endl;
+            return 1;
+        }
+    } else if (threads != 1) {
+        SaidaHash saida;
+        saida.hashType = hashType;
+        saida.hashSize = hashSize;
+        saida.mapped = mapped;
+        saida.exifThumbnail = exifThumbnail;
+        saida.timings = timings;
+        saida.out = &out;
+        saida.dedup = dedupTable.get();
 
+        // O pool vem antes do agendador: as tarefas voltam para ele ao terminar
+        PoolDeTarefas<TarefaHash> pool;
+        Agendador agendador(static_cast<unsigned>(threads));
+        std::vector<TarefaPtr> tarefas;
+        tarefas.reserve(paths.size());
+        for (const auto& path : paths)
+            if (!isArchivePath(path))
+                tarefas.push_back(pool.criar(path, saida));
+        agendador.adicionarTarefas(std::move(tarefas));
+
+        // Os arquivos são lidos aqui, em sequência, enquanto os trabalhadores hasheiam.
+        // Um arquivo que não abre não é tarefa: fica fora da contagem do agendador
+        size_t limite = 4 * agendador.numeroDeTrabalhadores();
+        int archiveFailures = 0;
+        for (const auto& path : paths) {
+            if (!isArchivePath(path))
+                continue;
+            try {
+                readArchive(path, [&](const std::string& member, std::vector<unsigned char>& data) {
+                    saida.reservar(limite);
+                    agendador.adicionarTarefa(pool.criar(archiveMemberPath(path, member), std::move(data), saida));
+                });
+            } catch (const std::exception& e) {
+                std::cerr << "ERROR: " << e.what() << std::endl;
+                archiveFailures++;
+            }
+        }
+        agendador.processarTudo();
+
+        ProgressoAgendador progresso = agendador.progresso();
+        std::cerr << "Hashed " << progresso.concluidas - saida.failures << " of " << progresso.submetidas
+                  << " images on " << agendador.numeroDeTrabalhadores() << " workers ("
+                  << progresso.tarefasPorSegundo << " images/s)" << std::endl;
+        if (archiveFailures > 0)
+            std::cerr << archiveFailures << " archives could not be read" << std::endl;
+        failures = saida.failures + archiveFailures;
+    } else {
+        for (const auto& path : paths) {
+            if (isArchivePath(path)) {
+                try {
+                    readArchive(path, [&](const std::string& member, std::vector<unsigned char>& data) {
+                        std::string memberPath = archiveMemberPath(path, member);
+                        auto start = std::chrono::steady_clock::now();
+                        std::string hash;
+                        // Um membro que não decodifica não pode parar a leitura do resto do arquivo
+                        try {
+                            hash = dedupTable ? dedupTable->hashData(data.data(), data.size(), memberPath)
+                                              : hashImageData(data.data(), data.size(), memberPath, hashType, hashSize, exifThumbnail);
+                        } catch (const std::exception& e) {
+                            std::cerr << "ERROR: " << memberPath << ": " << e.what() << std::endl;
+                        }
+                        if (hash.empty()) {
+                            failures++;
+                            return;
+                        }
+                        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+                        out << hash << "\t" << memberPath;
+                        if (timings)
+                            out << "\t" << micros;
+                        out << "\n";
+                    });
+                } catch (const std::exception& e) {
+                    std::cerr << "ERROR: " << e.what() << std::endl;
+                    failures++;
+                }
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            try {
+                std::string hash = dedupTable ? dedupTable->hashFile(path) : hashImageFile(path, hashType, hashSize, mapped, exifThumbnail);
+                if (hash.empty()) {
+                    failures++;
+                    continue;
+                }
+
+                auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+                out << hash << "\t" << path;
+                if (timings)
+                    out << "\t" << micros;
+                out << "\n";
+            } catch (const std::exception& e) {
+                std::cerr << "ERROR: " << path << ": " << e.what() << std::endl;
+                failures++;
+            }
+        }
+    }
+
+    if (dedupTable) {
+        DedupStats stats = dedupTable->stats();
+        std::cerr << "Dedup: " << stats.hits << " of " << stats.lookups << " inputs were exact duplicates ("
+                  << (stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0) << "%), saved ~"
+                  << stats.savedMicros / 1000 << " ms of decoding for " << stats.contentMicros / 1000
+                  << " ms of content hashing" << std::endl;
+    }
+
+    if (exifThumbnail) {
+        const ThumbnailStats& stats = thumbnailStats();
+        size_t total = stats.thumbnails + stats.reduced + stats.full;
+        std::cerr << "EXIF thumbnails: " << stats.thumbnails << " of " << total << " images ("
+                  << (total ? 100.0 * stats.thumbnails / total : 0.0) << "%), reduced decodes: " << stats.reduced
+                  << ", full decodes: " << stats.full << std::endl;
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hashOps.hpp"
+#include "hashCluster.hpp"
+
+// Nightly near-duplicate grouping over a hash corpus.
+// Each output line is: cluster number, size, then the 0-based positions of
+// its members in the input file.
+static void usage(const char* program) {
+    std::cerr << "Usage: " << program << " <hashes> [--threshold T] [--bands B] [--threads N]"
+              << " [--min-size S] [--out clusters.txt]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string input = argv[1], output;
+    ClusterOptions options;
+    size_t minSize = 2;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        try {
+            if (arg == "--threshold") options.threshold = std::stoi(argv[++i]);
+            else if (arg == "--bands") options.bands = std::stoi(argv[++i]);
+            else if (arg == "--threads") options.threads = std::stoi(argv[++i]);
+            else if (arg == "--min-size") minSize = std::stoul(argv[++i]);
+            else if (arg == "--out") output = argv[++i];
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::logic_error&) {
+            // std::invalid_argument / std::out_of_range de stoi
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    try {
+        PackedHashes hashes = readHashFile(input);
+        ClusterResult result = clusterHashes(hashes, options);
+        std::vector<std::vector<uint32_t>> clusters = groupClusters(result.labels, minSize);
+
+        std::ofstream file;
+        if (!output.empty()) {
+            file.open(output, std::ios::trunc);
+            if (!file)
+                throw std::runtime_error("Can't open " + output);
+        }
+        std::ostream& out = output.empty() ? std::cout : file;
+
+        size_t clustered = 0;
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            out << c << "\t" << clusters[c].size() << "\t";
+            for (size_t k = 0; k < clusters[c].size(); ++k)
+                out << (k ? " " : "") << clusters[c][k];
+            out << "\n";
+            clustered += clusters[c].size();
+        }
+        out.flush();
+
+        const ClusterStats& stats = result.stats;
+        double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+        std::cerr << "Hashes: " << stats.hashes << " (" << stats.uniqueHashes << " unique, "
+                  << hashes.bits << " bits)" << std::endl;
+        std::cerr << "Candidates: " << stats.candidatePairs << ", matched: " << stats.matchedPairs
+                  << ", largest bucket: " << stats.largestBucket << std::endl;
+        std::cerr << "Clusters: " << clusters.size() << " covering " << clustered << " hashes" << std::endl;
+        std::cerr << "Time: " << stats.seconds << " s, " << stats.hashes / seconds << " hashes/s, "
+                  << stats.candidatePairs / seconds << " pairs/s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
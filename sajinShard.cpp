@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hashOps.hpp"
+#include "hashShard.hpp"
+#include "concurrentHashIndex.hpp"
+
+// Sharded hash catalog, one process per shard, all on the same machine:
+//
+//   sajinShard build hashes.txt 4 /tmp/catalog
+//   sajinShard serve /tmp/catalog.0.idx /tmp/catalog.0.sock &   (once per shard)
+//   sajinShard query /tmp/catalog.0.sock,/tmp/catalog.1.sock,... d879f8f89b1bbf00 --knn 10
+//   sajinShard bench <sockets> queries.txt --radius 8
+//   sajinShard insert <sockets> new.txt 1000000      (ids from 1000000 on)
+//   sajinShard stress --readers 8 --writers 2       (in-process ConcurrentHashIndex check)
+static void usage(const char* program) {
+    std::cerr << "Usage:\n"
+              << "  " << program << " build <hashes> <shards> <prefix>\n"
+              << "  " << program << " serve <shard.idx> <socket>\n"
+              << "  " << program << " query <socket,...> <hex> [--radius R | --knn K]\n"
+              << "  " << program << " bench <socket,...> <hashes> [--radius R | --knn K]\n"
+              << "  " << program << " insert <socket,...> <hashes> <first-id>\n"
+              << "  " << program << " rebuild <socket,...>\n"
+              << "  " << program << " stress [--readers R] [--writers W] [--seconds S] [--base N] [--delta D] [--inserts I]" << std::endl;
+}
+
+static std::vector<std::string> splitSockets(const std::string& list) {
+    std::vector<std::string> sockets;
+    std::stringstream stream(list);
+    std::string path;
+    while (std::getline(stream, path, ','))
+        if (!path.empty())
+            sockets.push_back(path);
+    return sockets;
+}
+
+struct QueryMode {
+    bool knn = false;
+    int value = 8; // radius or k
+};
+
+static QueryMode parseQueryMode(int argc, char* argv[], int first) {
+    QueryMode mode;
+    for (int i = first; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--radius") mode = {false, std::stoi(argv[i + 1])};
+        else if (arg == "--knn") mode = {true, std::stoi(argv[i + 1])};
+        else throw std::invalid_argument("Unknown option " + arg);
+    }
+    return mode;
+}
+
+// The shards only compare word counts, so a shorter hash would be zero-padded
+// into a query (or an insert) for a hash nobody asked for
+static void checkHashBits(ShardCoordinator& coordinator, int bits, const std::string& what) {
+    int shardBits = coordinator.hashBits();
+    if (bits != shardBits)
+        throw std::invalid_argument(what + " has " + std::to_string(bits) + " bits, the shards hold "
+                                    + std::to_string(shardBits) + " bit hashes");
+}
+
+static std::vector<HashMatch> runQuery(ShardCoordinator& coordinator, const uint64_t* query, int words,
+                                       const QueryMode& mode) {
+    return mode.knn ? coordinator.knnQuery(query, words, mode.value)
+                    : coordinator.radiusQuery(query, words, mode.value);
+}
+
+struct StressOptions {
+    int readers = 8;
+    int writers = 2;
+    double seconds = 5;
+    size_t base = 200000;
+    size_t delta = 4096;
+    size_t inserts = 100000; // per writer
+};
+
+static uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Readers and writers hammer one ConcurrentHashIndex at the same time.
+// Writer w adds `inserts` ids base + w, base + w + W, ... in order, each hash within
+// 2 bits of its own pattern, and publishes how many of its adds returned.
+// A radius 4 query around pattern w then returns exactly writer w's hashes,
+// so every answer can be checked against what must be visible:
+//   - no gaps: the ids seen form a prefix of the writer's sequence, since
+//     a later add can't be visible without the earlier ones;
+//   - no stale reads: the prefix covers every add completed before the
+//     query started, and never shrinks between two queries of a reader.
+// Returns the number of violations.
+static size_t runStress(const StressOptions& options) {
+    if (options.readers < 1 || options.writers < 1)
+        throw std::invalid_argument("stress needs at least one reader and one writer");
+
+    // Patterns far apart (> 16 bits) so radius 4 can't reach another writer
+    uint64_t seed = 2024;
+    std::vector<uint64_t> patterns;
+    while (patterns.size() < static_cast<size_t>(options.writers) + 1) {
+        uint64_t candidate = splitmix64(seed);
+        bool farEnough = true;
+        for (uint64_t pattern : patterns)
+            farEnough = farEnough && hammingDistance(&candidate, &pattern, 1) > 16;
+        if (farEnough)
+            patterns.push_back(candidate);
+    }
+    uint64_t basePattern = patterns.back();
+
+    auto nearPattern = [](uint64_t pattern, std::mt19937_64& random) {
+        return pattern ^ (1ULL << (random() % 64)) ^ (1ULL << (random() % 64));
+    };
+
+    HashIndex base(64);
+    std::mt19937_64 random(1);
+    for (size_t i = 0; i < options.base; ++i) {
+        uint64_t hash = nearPattern(basePattern, random);
+        base.add(i, &hash);
+    }
+    ConcurrentHashIndex index(std::move(base), options.delta);
+
+    std::vector<std::atomic<uint64_t>> completed(options.writers);
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> inserts{0}, queries{0}, violations{0};
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < options.writers; ++w) {
+        threads.emplace_back([&, w] {
+            std::mt19937_64 random(100 + w);
+            for (uint64_t k = 0; k < options.inserts && !stop.load(std::memory_order_relaxed); ++k) {
+                uint64_t hash = nearPattern(patterns[w], random);
+                index.add(options.base + w + k * options.writers, &hash);
+                completed[w].store(k + 1, std::memory_order_release);
+            }
+            inserts += completed[w].load();
+        });
+    }
+    for (int r = 0; r < options.readers; ++r) {
+        threads.emplace_back([&, r] {
+            std::mt19937_64 random(200 + r);
+            std::vector<uint64_t> lastSeen(options.writers, 0);
+            std::vector<uint64_t> seen;
+            size_t done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                int w = static_cast<int>(random() % options.writers);
+                uint64_t mustSee = completed[w].load(std::memory_order_acquire);
+
+                seen.clear();
+                for (const auto& match : index.radiusQuery(&patterns[w], 4)) {
+                    uint64_t offset = match.id - options.base;
+                    if (match.id < options.base || offset % options.writers != static_cast<uint64_t>(w)) {
+                        violations++; // someone else's hash
+                        continue;
+                    }
+                    seen.push_back(offset / options.writers);
+                }
+                std::sort(seen.begin(), seen.end());
+
+                bool prefix = true;
+                for (size_t i = 0; i < seen.size(); ++i)
+                    prefix = prefix && seen[i] == i;
+                if (!prefix || seen.size() < mustSee || seen.size() < lastSeen[w])
+                    violations++;
+                lastSeen[w] = seen.size();
+                done++;
+            }
+            queries += done;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+    stop = true;
+    for (auto& thread : threads)
+        thread.join();
+
+    std::cout << "Readers: " << options.readers << ", writers: " << options.writers
+              << ", final size: " << index.size() << ", merges: " << index.merges() << std::endl;
+    std::cout << "Inserts/s: " << inserts / options.seconds << ", queries/s: " << queries / options.seconds << std::endl;
+    std::cout << "Violations: " << violations << std::endl;
+    return violations;
+}
+
+static StressOptions parseStressOptions(int argc, char* argv[], int first) {
+    StressOptions options;
+    for (int i = first; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--readers") options.readers = std::stoi(argv[i + 1]);
+        else if (arg == "--writers") options.writers = std::stoi(argv[i + 1]);
+        else if (arg == "--seconds") options.seconds = std::stod(argv[i + 1]);
+        else if (arg == "--base") options.base = std::stoull(argv[i + 1]);
+        else if (arg == "--delta") options.delta = std::stoull(argv[i + 1]);
+        else if (arg == "--inserts") options.inserts = std::stoull(argv[i + 1]);
+        else throw std::invalid_argument("Unknown option " + arg);
+    }
+    return options;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string command = argv[1];
+    try {
+        if (command == "build" && argc == 5) {
+            PackedHashes hashes = readHashFile(argv[2]);
+            auto start = std::chrono::steady_clock::now();
+            buildShards(hashes, std::stoi(argv[3]), argv[4]);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cerr << "Wrote " << argv[3] << " shards of " << hashes.size() << " hashes in " << seconds << " s" << std::endl;
+        } else if (command == "serve" && argc == 4) {
+            serveShard(argv[2], argv[3]);
+        } else if (command == "query" && argc >= 4) {
+            QueryMode mode = parseQueryMode(argc, argv, 4);
+            ShardCoordinator coordinator(splitSockets(argv[2]));
+
+            std::string hex = argv[3];
+            checkHashBits(coordinator, static_cast<int>(hex.size() * 4), "Hash " + hex);
+            std::vector<uint64_t> query(wordsForBits(static_cast<int>(hex.size() * 4)));
+            if (!hexToWords(hex, query.data(), static_cast<int>(query.size())))
+                throw std::invalid_argument("Invalid hash " + hex);
+
+            for (const auto& match : runQuery(coordinator, query.data(), static_cast<int>(query.size()), mode))
+                std::cout << match.id << "\t" << match.distance << "\n";
+        } else if (command == "bench" && argc >= 4) {
+            QueryMode mode = parseQueryMode(argc, argv, 4);
+            ShardCoordinator coordinator(splitSockets(argv[2]));
+            PackedHashes queries = readHashFile(argv[3]);
+            checkHashBits(coordinator, queries.bits, argv[3]);
+
+            std::vector<double> latencies;
+            size_t results = 0;
+            for (size_t q = 0; q < queries.size(); ++q) {
+                auto start = std::chrono::steady_clock::now();
+                results += runQuery(coordinator, queries.at(q), queries.wordsPerHash, mode).size();
+                latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+            if (latencies.empty())
+                throw std::invalid_argument("No queries in " + std::string(argv[3]));
+
+            std::sort(latencies.begin(), latencies.end());
+            double total = 0;
+            for (double latency : latencies)
+                total += latency;
+            std::cout << "Shards: " << coordinator.shardCount() << ", hashes: " << coordinator.totalHashes() << std::endl;
+            std::cout << "Queries: " << latencies.size() << ", results: " << results << std::endl;
+            std::cout << "Latency ms: p50 " << latencies[latencies.size() / 2]
+                      << ", p99 " << latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)]
+                      << ", mean " << total / latencies.size() << std::endl;
+            std::cout << "QPS: " << latencies.size() / (total / 1000.0) << std::endl;
+        } else if (command == "insert" && argc == 5) {
+            ShardCoordinator coordinator(splitSockets(argv[2]));
+            PackedHashes hashes = readHashFile(argv[3]);
+            checkHashBits(coordinator, hashes.bits, argv[3]);
+            uint64_t firstId = std::stoull(argv[4]);
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < hashes.size(); ++i)
+                coordinator.insert(firstId + i, hashes.at(i), hashes.wordsPerHash);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cerr << "Inserted " << hashes.size() << " hashes in " << seconds << " s, "
+                      << coordinator.totalHashes() << " hashes in total" << std::endl;
+        } else if (command == "stress") {
+            if (runStress(parseStressOptions(argc, argv, 2)) > 0)
+                return 1;
+        } else if (command == "rebuild" && argc == 3) {
+            ShardCoordinator coordinator(splitSockets(argv[2]));
+            auto start = std::chrono::steady_clock::now();
+            size_t total = coordinator.rebuild();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cerr << "Reloaded " << coordinator.shardCount() << " shards (" << total << " hashes) in " << seconds << " s" << std::endl;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
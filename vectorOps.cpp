@@ -2,11 +2,17 @@
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdlib>
 #include <vector>
 #include <iostream>
 #include <set>
 #include <string>
 
+#include "vectorOps.hpp"
+#include "mappedFile.h"
+#include "jpegReader.h"
+
 // 3D Vector 
 using Vector3D = std::vector<std::vector<std::vector<uint8_t>>>;
 using Vector2D = std::vector<std::vector<uint8_t>>;
@@ -127,17 +133,139 @@ cv::Mat vector2DToMatGS(const Vector2D& vec) {
 }
 
 cv::Mat readImageMat(const std::string path) {
-    cv::Mat image = cv::imread(path, cv::COLOR_BGR2RGB);
+    cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
     if (image.empty()) {
-        std::cerr << "ERROR: Empty Image!" << std::endl;
+        std::cerr << "ERROR: Can't read image " << path << std::endl;
+        return {};
+    }
+
+    return image;
+}
+
+cv::Mat decodeImageMat(const unsigned char* data, size_t size, const std::string& name) {
+    cv::Mat image;
+    try {
+        // Mat não-proprietária apontando para os bytes (nenhuma cópia)
+        cv::Mat encoded(1, static_cast<int>(size), CV_8UC1, const_cast<unsigned char*>(data));
+        image = cv::imdecode(encoded, cv::IMREAD_COLOR);
+    } catch (const cv::Exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+    }
+
+    if (image.empty()) {
+        std::cerr << "ERROR: Can't decode image " << name << std::endl;
+        return {};
+    }
+    return image;
+}
+
+// Hot-cache path: decodes straight from a read-only mapping of the file, so the
+// encoded bytes never go through a libc buffer or an intermediate std::vector
+cv::Mat readImageMatMapped(const std::string path) {
+    MappedFile file;
+    if (map_file(path.c_str(), &file) != 0)
+        return {};
+
+    cv::Mat image = decodeImageMat(file.data, file.size, path);
+    if (file.truncated) {
+        std::cerr << "ERROR: " << path << " was truncated while it was being read" << std::endl;
+        image = cv::Mat();
+    }
+    unmap_file(&file);
+    return image;
+}
+
+ThumbnailStats& thumbnailStats() {
+    static ThumbnailStats stats;
+    return stats;
+}
+
+// EXIF orientation 1..8 -> the image as it should be displayed
+cv::Mat applyExifOrientation(const cv::Mat& image, int orientation) {
+    cv::Mat oriented;
+    switch (orientation) {
+    case 2: cv::flip(image, oriented, 1); break;
+    case 3: cv::rotate(image, oriented, cv::ROTATE_180); break;
+    case 4: cv::flip(image, oriented, 0); break;
+    case 5: cv::transpose(image, oriented); break;
+    case 6: cv::rotate(image, oriented, cv::ROTATE_90_CLOCKWISE); break;
+    case 7: cv::transpose(image, oriented); cv::flip(oriented, oriented, -1); break;
+    case 8: cv::rotate(image, oriented, cv::ROTATE_90_COUNTERCLOCKWISE); break;
+    default: oriented = image;
+    }
+    return oriented;
+}
+
+// Cameras letterbox the thumbnail into 160x120 when the sensor isn't 4:3,
+// and hashing the black bars would move the hash: same aspect within 2% only
+static bool sameAspect(int thumbWidth, int thumbHeight, int width, int height) {
+    long long a = static_cast<long long>(thumbWidth) * height;
+    long long b = static_cast<long long>(thumbHeight) * width;
+    return std::llabs(a - b) * 50 <= b;
+}
+
+// Biggest libjpeg downscale (1/8, 1/4, 1/2) keeping the short side at least
+// 4x the hash input size. imdecode applies the EXIF orientation itself.
+static int reducedDecodeFlags(int width, int height, int minSide) {
+    int shortSide = std::min(width, height);
+    if (shortSide / 8 >= 4 * minSide) return cv::IMREAD_REDUCED_COLOR_8;
+    if (shortSide / 4 >= 4 * minSide) return cv::IMREAD_REDUCED_COLOR_4;
+    if (shortSide / 2 >= 4 * minSide) return cv::IMREAD_REDUCED_COLOR_2;
+    return cv::IMREAD_COLOR;
+}
+
+cv::Mat decodeImageMatThumbnail(const unsigned char* data, size_t size, const std::string& name, int minSide) {
+    ThumbnailStats& stats = thumbnailStats();
+    cv::Mat image;
+    try {
+        JpegExifInfo info;
+        bool isJpeg = read_jpeg_exif(data, size, &info) == 0;
+
+        if (isJpeg && info.thumbnail != nullptr) {
+            cv::Mat encoded(1, static_cast<int>(info.thumbnail_size), CV_8UC1, const_cast<unsigned char*>(info.thumbnail));
+            cv::Mat thumbnail = cv::imdecode(encoded, cv::IMREAD_COLOR);
+            if (!thumbnail.empty() && std::min(thumbnail.cols, thumbnail.rows) >= minSide &&
+                sameAspect(thumbnail.cols, thumbnail.rows, info.width, info.height)) {
+                image = applyExifOrientation(thumbnail, info.orientation);
+                stats.thumbnails++;
+            }
+        }
+
+        // Sem miniatura utilizável: decodifica a imagem principal, reduzida quando dá
+        if (image.empty()) {
+            int flags = isJpeg ? reducedDecodeFlags(info.width, info.height, minSide) : cv::IMREAD_COLOR;
+            cv::Mat encoded(1, static_cast<int>(size), CV_8UC1, const_cast<unsigned char*>(data));
+            image = cv::imdecode(encoded, flags);
+            if (!image.empty())
+                (flags == cv::IMREAD_COLOR ? stats.full : stats.reduced)++;
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+    }
+
+    if (image.empty()) {
+        std::cerr << "ERROR: Can't decode image " << name << std::endl;
         return {};
     }
+    return image;
+}
+
+cv::Mat readImageMatThumbnail(const std::string path, int minSide) {
+    MappedFile file;
+    if (map_file(path.c_str(), &file) != 0)
+        return {};
 
+    cv::Mat image = decodeImageMatThumbnail(file.data, file.size, path, minSide);
+    if (file.truncated) {
+        std::cerr << "ERROR: " << path << " was truncated while it was being read" << std::endl;
+        image = cv::Mat();
+    }
+    unmap_file(&file);
     return image;
 }
 
 Vector3D readImageVector(const std::string path) {
-    cv::Mat image = cv::imread(path, cv::COLOR_BGR2RGB);
+    cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
     if (image.empty()) {
         std::cerr << "ERROR: Empty Image!" << std::endl;
         return {};
@@ -338,7 +466,7 @@ Vector1D flattenVector2D(const Vector2D& vec) {
 
     for(size_t i = 0; i < rows; i++){
         for (size_t j = 0; j < columns; j++) {
-            flattened[i + j] = vec[i][j];
+            flattened[i * columns + j] = vec[i][j];
         }
     }
     return flattened; 
@@ -347,12 +475,12 @@ Vector1D flattenVector2D(const Vector2D& vec) {
 Vector1D flattenVector3D(const Vector3D& vec) {
     size_t rows = vec.size(), columns = vec[0].size();
     size_t channels = vec[0][0].size();
-    Vector1D flattened(rows * columns);
+    Vector1D flattened(rows * columns * channels);
 
     for (size_t i = 0; i < rows; i++){
         for (size_t j = 0; j < columns; j++) {
             for (size_t k = 0; k < channels; k++) {
-                flattened[i + j + k] = vec[i][j][k];
+                flattened[(i * columns + j) * channels + k] = vec[i][j][k];
             }
         }
     }
@@ -2,6 +2,7 @@
 #define VECTOROPS_HPP
 
 #include <opencv2/core/core.hpp>
+#include <atomic>
 #include <vector>
 #include <string>
 #include <cstdint>
@@ -20,6 +21,26 @@ cv::Mat vector3DToMat(const Vector3D& vec);
 
 // I/O functions
 cv::Mat readImageMat(const std::string path);
+cv::Mat readImageMatMapped(const std::string path);
+// Opt-in fast path for camera JPEGs: decodes the EXIF thumbnail instead of the
+// main image when its short side is at least minSide and its aspect ratio
+// matches, then applies the EXIF orientation. Otherwise falls back to a
+// reduced (1/2..1/8) decode of JPEGs and a full decode of anything else.
+cv::Mat readImageMatThumbnail(const std::string path, int minSide);
+// Same decodes for encoded bytes already in memory (a mapping, an archive
+// member); `name` only labels the error messages
+cv::Mat decodeImageMat(const unsigned char* data, size_t size, const std::string& name);
+cv::Mat decodeImageMatThumbnail(const unsigned char* data, size_t size, const std::string& name, int minSide);
+
+// How often readImageMatThumbnail took each path, process wide
+struct ThumbnailStats {
+    std::atomic<size_t> thumbnails{0};
+    std::atomic<size_t> reduced{0};
+    std::atomic<size_t> full{0};
+};
+ThumbnailStats& thumbnailStats();
+// EXIF orientation 1..8 (what read_jpeg_exif reports) applied the way imread does
+cv::Mat applyExifOrientation(const cv::Mat& image, int orientation);
 Vector3D readImageVector(const std::string path);
 
 // Statistical functions
@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "watchMode.hpp"
+#include "imageHash.hpp"
+#include "dedupTable.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_MODIFY | IN_ONLYDIR;
+
+// Same list as compareHashes.py
+const char* IMAGE_EXTENSIONS[] = {".jpg", ".jpeg", ".png", ".bmp", ".gif", ".webp", ".tif", ".tiff"};
+
+// Dot files are skipped: rsync, browsers and editors write to a hidden
+// temporary name and rename it into place once it is complete
+bool isImageName(const std::string& name) {
+    if (name.empty() || name[0] == '.')
+        return false;
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos)
+        return false;
+    std::string extension = name.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (const char* known : IMAGE_EXTENSIONS)
+        if (extension == known)
+            return true;
+    return false;
+}
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void requestStop(int) {
+    stopRequested = 1;
+}
+
+// SIGINT/SIGTERM end the watch instead of the process, while it runs. They
+// stay blocked outside ppoll(), so one arriving just before the wait still
+// wakes it up. Signals the caller ignores (nohup, background jobs) stay ignored.
+class StopSignals {
+public:
+    StopSignals() {
+        stopRequested = 0;
+        sigset_t stopSet;
+        sigemptyset(&stopSet);
+        for (size_t i = 0; i < COUNT; ++i) {
+            sigaction(SIGNALS[i], nullptr, &previous[i]);
+            if (previous[i].sa_handler == SIG_IGN)
+                continue;
+            struct sigaction action;
+            std::memset(&action, 0, sizeof(action));
+            action.sa_handler = requestStop;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGNALS[i], &action, nullptr);
+            sigaddset(&stopSet, SIGNALS[i]);
+        }
+        pthread_sigmask(SIG_BLOCK, &stopSet, &previousMask);
+        waitMask = previousMask;
+        for (size_t i = 0; i < COUNT; ++i)
+            if (sigismember(&stopSet, SIGNALS[i]))
+                sigdelset(&waitMask, SIGNALS[i]);
+    }
+
+    ~StopSignals() {
+        pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+        for (size_t i = 0; i < COUNT; ++i)
+            sigaction(SIGNALS[i], &previous[i], nullptr);
+    }
+
+    StopSignals(const StopSignals&) = delete;
+    StopSignals& operator=(const StopSignals&) = delete;
+
+    // Mask for ppoll(): the caller's, with the stop signals let through
+    const sigset_t* duringWait() const { return &waitMask; }
+
+private:
+    static constexpr size_t COUNT = 2;
+    static constexpr int SIGNALS[COUNT] = {SIGINT, SIGTERM};
+
+    struct sigaction previous[COUNT];
+    sigset_t previousMask;
+    sigset_t waitMask;
+};
+
+struct PendingFile {
+    Clock::time_point seen;     // last close/move, start of the reported latency
+    Clock::time_point deadline; // hashed once nothing happened to it until then
+    bool closed;                // IN_MODIFY alone never makes a file ready
+};
+
+class TreeWatcher {
+public:
+    TreeWatcher(const std::string& root, const WatchOptions& options, const WatchSink& sink)
+        : root(root), options(options), sink(sink) {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+            throw std::runtime_error(std::string("inotify_init1 failed: ") + std::strerror(errno));
+    }
+
+    ~TreeWatcher() {
+        close(fd);
+    }
+
+    TreeWatcher(const TreeWatcher&) = delete;
+    TreeWatcher& operator=(const TreeWatcher&) = delete;
+
+    void run() {
+        addTree(root, false, 0);
+        if (directories.empty())
+            throw std::runtime_error("Can't watch " + root);
+        std::cerr << "Watching " << directories.size() << " directories under " << root << std::endl;
+
+        StopSignals signals;
+        pollfd pfd{fd, POLLIN, 0};
+        while (!stopRequested) {
+            // Sem nada pendente o ppoll dorme até o próximo evento ou sinal
+            int timeout = pollTimeout();
+            timespec wait{timeout / 1000, (timeout % 1000) * 1000000L};
+            if (ppoll(&pfd, 1, timeout < 0 ? nullptr : &wait, signals.duringWait()) < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error(std::string("ppoll failed: ") + std::strerror(errno));
+            }
+            if (pfd.revents & POLLIN)
+                readEvents();
+            hashReady();
+        }
+    }
+
+private:
+    std::string root;
+    const WatchOptions& options;
+    const WatchSink& sink;
+    int fd;
+    std::unordered_map<int, std::string> directories; // watch descriptor -> path
+    std::unordered_map<std::string, PendingFile> pending;
+    time_t lastRead = 0;
+
+    // Watches `dir` and everything below it. With `queueFiles` the images
+    // already there are queued too: they may have been written before the
+    // watch existed, or after an event queue overflow (then only the ones
+    // modified since `since`).
+    void addTree(const std::string& dir, bool queueFiles, time_t since) {
+        int wd = inotify_add_watch(fd, dir.c_str(), WATCH_MASK);
+        if (wd < 0) {
+            std::cerr << "ERROR: Can't watch " << dir << ": " << std::strerror(errno) << std::endl;
+            return;
+        }
+        // A directory moved inside the tree keeps its descriptor, only the path changes
+        directories[wd] = dir;
+
+        DIR* handle = opendir(dir.c_str());
+        if (handle == nullptr)
+            return;
+        std::vector<std::string> subdirectories;
+        while (dirent* entry = readdir(handle)) {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..")
+                continue;
+            std::string path = dir + "/" + name;
+            struct stat info;
+            if (lstat(path.c_str(), &info) != 0)
+                continue;
+            if (S_ISDIR(info.st_mode))
+                subdirectories.push_back(path);
+            else if (queueFiles && S_ISREG(info.st_mode) && isImageName(name) && info.st_mtime >= since)
+                markReady(path, Clock::now());
+        }
+        closedir(handle);
+
+        for (const auto& subdirectory : subdirectories)
+            addTree(subdirectory, queueFiles, since);
+    }
+
+    // Forgets the watches of a directory moved out of place. If it was moved
+    // within the tree, the IN_MOVED_TO that follows watches it again.
+    void removeTree(const std::string& dir) {
+        std::string prefix = dir + "/";
+        for (auto it = directories.begin(); it != directories.end();) {
+            if (it->second == dir || it->second.compare(0, prefix.size(), prefix) == 0) {
+                inotify_rm_watch(fd, it->first);
+                it = directories.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void markReady(const std::string& path, Clock::time_point now) {
+        PendingFile& file = pending[path];
+        file.seen = now;
+        file.deadline = now + std::chrono::milliseconds(options.debounceMs);
+        file.closed = true;
+    }
+
+    int pollTimeout() const {
+        bool any = false;
+        Clock::time_point next;
+        for (const auto& entry : pending) {
+            if (entry.second.closed && (!any || entry.second.deadline < next)) {
+                next = entry.second.deadline;
+                any = true;
+            }
+        }
+        if (!any)
+            return -1;
+        auto wait = std::chrono::ceil<std::chrono::milliseconds>(next - Clock::now()).count();
+        return static_cast<int>(std::max<long long>(wait, 0));
+    }
+
+    void readEvents() {
+        alignas(inotify_event) char buffer[64 * 1024];
+        while (true) {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length < 0 && errno == EINTR)
+                continue;
+            if (length < 0 && errno == EAGAIN)
+                break;
+            if (length <= 0)
+                throw std::runtime_error(std::string("inotify read failed: ") + std::strerror(errno));
+
+            Clock::time_point now = Clock::now();
+            for (char* cursor = buffer; cursor < buffer + length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+                handleEvent(event, now);
+                cursor += sizeof(inotify_event) + event->len;
+            }
+        }
+        lastRead = time(nullptr);
+    }
+
+    void handleEvent(const inotify_event* event, Clock::time_point now) {
+        if (event->mask & IN_Q_OVERFLOW) {
+            // Events were dropped: rescan for what changed since the last good read
+            std::cerr << "WARNING: inotify queue overflow, rescanning " << root << std::endl;
+            addTree(root, true, lastRead - 1);
+            return;
+        }
+        if (event->mask & IN_IGNORED) {
+            directories.erase(event->wd);
+            return;
+        }
+
+        auto dir = directories.find(event->wd);
+        if (dir == directories.end() || event->len == 0)
+            return;
+        std::string name = event->name;
+        std::string path = dir->second + "/" + name;
+
+        if (event->mask & IN_ISDIR) {
+            if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                addTree(path, true, 0);
+            else if (event->mask & IN_MOVED_FROM)
+                removeTree(path);
+            return;
+        }
+        if (!isImageName(name))
+            return;
+
+        if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+            markReady(path, now);
+        } else if (event->mask & IN_MOVED_FROM) {
+            pending.erase(path);
+        } else if (event->mask & (IN_CREATE | IN_MODIFY)) {
+            // Still being written: wait for the close
+            auto it = pending.find(path);
+            if (it != pending.end())
+                it->second.closed = false;
+        }
+    }
+
+    void hashReady() {
+        Clock::time_point now = Clock::now();
+        std::vector<std::pair<std::string, Clock::time_point>> ready;
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (it->second.closed && it->second.deadline <= now) {
+                ready.emplace_back(it->first, it->second.seen);
+                it = pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        for (const auto& file : ready) {
+            // Gone again before its turn (e.g. a temporary file): nothing to report
+            struct stat info;
+            if (stat(file.first.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+                continue;
+            try {
+                std::string hash = options.dedup != nullptr
+                                       ? options.dedup->hashFile(file.first)
+                                       : hashImageFile(file.first, options.hashType, options.hashSize, options.mapped, options.exifThumbnail);
+                if (hash.empty())
+                    continue;
+                auto micros = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - file.second).count();
+                sink(file.first, hash, micros);
+            } catch (const std::exception& e) {
+                std::cerr << "ERROR: " << file.first << ": " << e.what() << std::endl;
+            }
+        }
+    }
+};
+
+}
+
+void watchDirectory(const std::string& root, const WatchOptions& options, const WatchSink& sink) {
+    std::string dir = root;
+    while (dir.size() > 1 && dir.back() == '/')
+        dir.pop_back();
+    TreeWatcher watcher(dir, options, sink);
+    watcher.run();
+}
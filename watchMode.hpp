@@ -0,0 +1,36 @@
+#ifndef WATCHMODE_HPP
+#define WATCHMODE_HPP
+
+#include <functional>
+#include <string>
+
+class DedupTable;
+
+struct WatchOptions {
+    std::string hashType = "ahash";
+    int hashSize = 8;
+    bool mapped = false;
+    bool exifThumbnail = false;
+    // Quiet time after the last event of a file before it is hashed, so a
+    // writer that closes and reopens the same file only costs one hash
+    int debounceMs = 50;
+    // Optional exact-duplicate prefilter, so a file rewritten with the same
+    // bytes (or copied in again) is not decoded twice
+    DedupTable* dedup = nullptr;
+};
+
+// Called once per hashed file. `micros` is the time from the event that
+// made the file ready (close after write, or move into the tree) to the hash.
+using WatchSink = std::function<void(const std::string& path, const std::string& hash, long long micros)>;
+
+// Watches `root` and every directory below it with inotify and hashes image
+// files as they are written or moved in, through hashImageFile(). Files
+// already in the tree are not hashed. New directories are watched as they
+// appear, and files created in them before the watch existed are picked up.
+// Blocks in ppoll() between events, so an idle tree costs no CPU.
+// Returns on SIGINT or SIGTERM, whose handlers are only replaced while it
+// runs; files still waiting for their debounce then are not hashed.
+// Throws when inotify itself fails.
+void watchDirectory(const std::string& root, const WatchOptions& options, const WatchSink& sink);
+
+#endif // WATCHMODE_HPP